@@ -0,0 +1,237 @@
+#ifndef ACQ_SCHEDULER_H
+#define ACQ_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "soc/soc.h" // PRO_CPU_NUM / APP_CPU_NUM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "bmp280_reader.h"
+#include "ads1115_reader.h"
+
+// === Планировщик сбора данных ===
+// Период задаёт периодический esp_timer: следующий момент срабатывания считается от
+// предыдущего планового, а не от конца чтения, поэтому время опроса датчиков (>120 мс)
+// не накапливается. Таймер только будит задачу сбора, сама задача закреплена за APP_CPU,
+// а Wi-Fi и httpd остаются на PRO_CPU.
+
+#ifndef ACQ_PERIOD_US
+#define ACQ_PERIOD_US (5000 * 1000LL) // Период опроса датчиков, 5 с
+#endif
+
+#ifndef ACQ_TASK_PRIORITY
+// Выше httpd, но ниже Wi-Fi (23) и tcpip/lwIP (18 по умолчанию): если сетевая задача
+// окажется на APP_CPU, сбор её не вытеснит
+#define ACQ_TASK_PRIORITY (configMAX_PRIORITIES - 8)
+#endif
+
+#ifndef ACQ_TASK_STACK_SIZE
+#define ACQ_TASK_STACK_SIZE 4096
+#endif
+
+#ifndef HTTPD_TASK_PRIORITY
+#define HTTPD_TASK_PRIORITY (tskIDLE_PRIORITY + 5)
+#endif
+
+#if CONFIG_FREERTOS_UNICORE
+#define ACQ_TASK_CORE PRO_CPU_NUM // Одноядерная сборка: закреплять некуда
+#else
+#define ACQ_TASK_CORE APP_CPU_NUM
+#endif
+#define NET_TASK_CORE PRO_CPU_NUM
+
+// Задачи Wi-Fi и tcpip (lwIP) закрепляются за PRO_CPU в sdkconfig.defaults.
+// Предупреждения - на случай, если эти настройки переопределены в sdkconfig.
+#if CONFIG_ESP_WIFI_TASK_PINNED_TO_CORE_1 && !CONFIG_FREERTOS_UNICORE
+#warning "Wi-Fi task is pinned to APP_CPU and will share the core with acquisition"
+#endif
+#if !CONFIG_FREERTOS_UNICORE && !CONFIG_LWIP_TCPIP_TASK_AFFINITY_CPU0
+#warning "lwIP tcpip task is not pinned to PRO_CPU (CONFIG_LWIP_TCPIP_TASK_AFFINITY_CPU0) and may run on the acquisition core"
+#endif
+
+#define ACQ_MAX_SINKS 4
+
+static const char *TAG_ACQ = "ACQ";
+
+// Один отсчёт всех датчиков
+typedef struct {
+    uint32_t seq;        // Номер отсчёта с момента загрузки
+    int64_t  t_us;       // Фактическое время начала чтения (esp_timer, мкс)
+    int64_t  t_sched_us; // Плановое время отсчёта
+    int16_t  a0;
+    int16_t  a1;
+    int32_t  temp;       // °C * 100
+    uint32_t press;      // Па
+} acq_sample_t;
+
+// Статистика джиттера: отклонение фактического пробуждения от планового момента
+typedef struct {
+    uint32_t periods;         // Обработанные периоды
+    uint32_t overruns;        // Пропущенные периоды (чтение заняло больше периода)
+    int64_t  jitter_last_us;
+    int64_t  jitter_min_us;
+    int64_t  jitter_max_us;
+    int64_t  jitter_abs_sum_us; // Для среднего |джиттера|
+    int64_t  busy_last_us;    // Длительность чтения датчиков
+    int64_t  busy_max_us;
+} acq_stats_t;
+
+// Получатель новых отсчётов. Вызывается из задачи сбора, поэтому должен быть коротким
+typedef void (*acq_sink_fn)(const acq_sample_t *sample, void *ctx);
+
+static TaskHandle_t acq_task_handle = NULL;
+static esp_timer_handle_t acq_timer = NULL;
+static portMUX_TYPE acq_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t acq_t0_us;
+static acq_stats_t acq_stats;
+static acq_sample_t acq_latest;
+static bool acq_have_sample = false;
+
+static struct {
+    acq_sink_fn fn;
+    void *ctx;
+} acq_sinks[ACQ_MAX_SINKS];
+static int acq_sink_count = 0;
+
+// Регистрация получателя отсчётов (до acq_scheduler_start())
+bool acq_register_sink(acq_sink_fn fn, void *ctx) {
+    if (acq_sink_count >= ACQ_MAX_SINKS) {
+        ESP_LOGE(TAG_ACQ, "Too many sample sinks");
+        return false;
+    }
+    acq_sinks[acq_sink_count].fn = fn;
+    acq_sinks[acq_sink_count].ctx = ctx;
+    acq_sink_count++;
+    return true;
+}
+
+// Копия последнего отсчёта; false, если отсчётов ещё не было
+bool acq_get_latest(acq_sample_t *out) {
+    portENTER_CRITICAL(&acq_lock);
+    bool ok = acq_have_sample;
+    if (ok) {
+        *out = acq_latest;
+    }
+    portEXIT_CRITICAL(&acq_lock);
+    return ok;
+}
+
+void acq_get_stats(acq_stats_t *out) {
+    portENTER_CRITICAL(&acq_lock);
+    *out = acq_stats;
+    portEXIT_CRITICAL(&acq_lock);
+}
+
+// Статистика в JSON (для /acq_stats)
+int acq_stats_to_json(char *out, size_t maxlen) {
+    acq_stats_t s;
+    acq_get_stats(&s);
+    long long mean = s.periods ? s.jitter_abs_sum_us / s.periods : 0;
+    return snprintf(out, maxlen,
+                    "{\"period_us\": %lld, \"core\": %d, \"periods\": %lu, \"overruns\": %lu, "
+                    "\"jitter_last_us\": %lld, \"jitter_min_us\": %lld, \"jitter_max_us\": %lld, "
+                    "\"jitter_mean_abs_us\": %lld, \"busy_last_us\": %lld, \"busy_max_us\": %lld}",
+                    (long long)ACQ_PERIOD_US, ACQ_TASK_CORE,
+                    (unsigned long)s.periods, (unsigned long)s.overruns,
+                    (long long)s.jitter_last_us, (long long)s.jitter_min_us, (long long)s.jitter_max_us,
+                    mean, (long long)s.busy_last_us, (long long)s.busy_max_us);
+}
+
+// Колбэк esp_timer (задача esp_timer): только будит задачу сбора
+static void acq_timer_cb(void *arg) {
+    xTaskNotifyGive(acq_task_handle);
+}
+
+static void acq_task(void *arg) {
+    uint64_t period_index = 0;
+    uint32_t seq = 0;
+
+    while (1) {
+        // Значение уведомления > 1 означает, что пока шло чтение, таймер сработал ещё раз
+        uint32_t fired = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t now = esp_timer_get_time();
+        if (fired == 0) {
+            continue;
+        }
+        period_index += fired;
+        int64_t sched = acq_t0_us + (int64_t)period_index * ACQ_PERIOD_US;
+        int64_t jitter = now - sched;
+
+        acq_sample_t s = {
+            .seq = seq++,
+            .t_us = now,
+            .t_sched_us = sched,
+        };
+        s.a0 = ads1115_read_channel(0);
+        s.a1 = ads1115_read_channel(1);
+        bmp280_read_compensated_data(&s.temp, &s.press);
+        int64_t busy = esp_timer_get_time() - now;
+
+        portENTER_CRITICAL(&acq_lock);
+        if (acq_stats.periods == 0 || jitter < acq_stats.jitter_min_us) acq_stats.jitter_min_us = jitter;
+        if (acq_stats.periods == 0 || jitter > acq_stats.jitter_max_us) acq_stats.jitter_max_us = jitter;
+        acq_stats.periods++;
+        acq_stats.overruns += fired - 1;
+        acq_stats.jitter_last_us = jitter;
+        acq_stats.jitter_abs_sum_us += jitter < 0 ? -jitter : jitter;
+        acq_stats.busy_last_us = busy;
+        if (busy > acq_stats.busy_max_us) acq_stats.busy_max_us = busy;
+        acq_latest = s;
+        acq_have_sample = true;
+        portEXIT_CRITICAL(&acq_lock);
+
+        if (fired > 1) {
+            ESP_LOGW(TAG_ACQ, "Missed %lu period(s), acquisition took %lld us",
+                     (unsigned long)(fired - 1), (long long)busy);
+        }
+
+        for (int i = 0; i < acq_sink_count; i++) {
+            acq_sinks[i].fn(&s, acq_sinks[i].ctx);
+        }
+    }
+}
+
+// Запуск задачи сбора на APP_CPU и периодического таймера
+esp_err_t acq_scheduler_start(void) {
+    if (acq_task_handle != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    BaseType_t ok = xTaskCreatePinnedToCore(acq_task, "acq", ACQ_TASK_STACK_SIZE, NULL,
+                                            ACQ_TASK_PRIORITY, &acq_task_handle, ACQ_TASK_CORE);
+    if (ok != pdPASS) {
+        ESP_LOGE(TAG_ACQ, "Failed to create acquisition task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = acq_timer_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "acq",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &acq_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG_ACQ, "esp_timer_create failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    acq_t0_us = esp_timer_get_time();
+    err = esp_timer_start_periodic(acq_timer, ACQ_PERIOD_US);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG_ACQ, "esp_timer_start_periodic failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // Первый отсчёт сразу, не дожидаясь целого периода
+    acq_t0_us -= ACQ_PERIOD_US;
+    xTaskNotifyGive(acq_task_handle);
+
+    ESP_LOGI(TAG_ACQ, "Acquisition started: period %lld us, core %d, priority %d",
+             (long long)ACQ_PERIOD_US, ACQ_TASK_CORE, ACQ_TASK_PRIORITY);
+    return ESP_OK;
+}
+
+#endif // ACQ_SCHEDULER_H
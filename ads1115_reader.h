@@ -38,16 +38,11 @@ static void ads1115_init_if_needed() {
     // Для данного кода, её вызов в ads1115_read_channel() просто делает ads_initialized = true.
 
     ads_initialized = true;
-    ESP_LOGI(TAG_ADS, "ADS1115 setup (I2C driver assumed initialized).");
+    ESP_LOGD(TAG_ADS, "ADS1115 setup (I2C driver assumed initialized).");
 }
 
-int16_t ads1115_read_channel(uint8_t channel) {
-    // Убедимся, что I2C-драйвер инициализирован
-    // (функция i2c_bus_init_once() вызывается в app_main)
-    ads1115_init_if_needed(); // Вызов этой функции теперь просто устанавливает флаг ads_initialized
-
-    uint16_t config = 0x8483; // Single-shot, 16-bit, FSR +/-4.096V (по умолчанию), 128 SPS
-
+// Запуск одиночного преобразования (single-shot) на канале с заданной конфигурацией
+static esp_err_t ads1115_start_conversion(uint8_t channel, uint16_t config) {
     switch (channel) {
         case 0: config |= 0x4000; break; // AIN0/GND
         case 1: config |= 0x5000; break; // AIN1/GND
@@ -55,7 +50,7 @@ int16_t ads1115_read_channel(uint8_t channel) {
         case 3: config |= 0x7000; break; // AIN3/GND
         default:
             ESP_LOGE(TAG_ADS, "Invalid ADS1115 channel: %d", channel);
-            return 0;
+            return ESP_ERR_INVALID_ARG;
     }
     // Set 'Start a single conversion' bit (OS)
     config |= 0x8000;
@@ -76,31 +71,83 @@ int16_t ads1115_read_channel(uint8_t channel) {
 
     if (ret != ESP_OK) {
         ESP_LOGE(TAG_ADS, "Failed to write ADS1115 config: %s", esp_err_to_name(ret));
-        return 0;
     }
+    return ret;
+}
 
-    // ADS1115 требуется время для преобразования.
-    // Задержка зависит от Sample Rate (SPS). Для 128 SPS это ~7.8 мс. 10 мс достаточно.
-    vTaskDelay(pdMS_TO_TICKS(10));
-
+// Чтение 16-битного регистра ADS1115 (0x00 - результат, 0x01 - конфигурация)
+static esp_err_t ads1115_read_reg(uint8_t reg, uint16_t *value) {
     uint8_t data[2];
-    cmd = i2c_cmd_link_create();
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, (ADS1115_ADDR << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, 0x00, true); // Pointer to Conversion Register
+    i2c_master_write_byte(cmd, reg, true); // Pointer Register
     i2c_master_start(cmd); // Repeated start
     i2c_master_write_byte(cmd, (ADS1115_ADDR << 1) | I2C_MASTER_READ, true);
     i2c_master_read(cmd, data, 2, I2C_MASTER_LAST_NACK);
     i2c_master_stop(cmd);
-    ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(100));
+    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(100));
     i2c_cmd_link_delete(cmd);
 
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG_ADS, "Failed to read ADS1115 data: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG_ADS, "Failed to read ADS1115 register 0x%02X: %s", reg, esp_err_to_name(ret));
+        return ret;
+    }
+    *value = (uint16_t)((data[0] << 8) | data[1]);
+    return ESP_OK;
+}
+
+int16_t ads1115_read_channel(uint8_t channel) {
+    // Убедимся, что I2C-драйвер инициализирован
+    // (функция i2c_bus_init_once() вызывается в app_main)
+    ads1115_init_if_needed(); // Вызов этой функции теперь просто устанавливает флаг ads_initialized
+
+    // Single-shot, 16-bit, FSR +/-4.096V (по умолчанию), 128 SPS
+    if (ads1115_start_conversion(channel, 0x8483) != ESP_OK) {
+        return 0;
+    }
+
+    // ADS1115 требуется время для преобразования.
+    // Задержка зависит от Sample Rate (SPS). Для 128 SPS это ~7.8 мс. 10 мс достаточно.
+    vTaskDelay(pdMS_TO_TICKS(10));
+
+    uint16_t raw;
+    if (ads1115_read_reg(0x00, &raw) != ESP_OK) {
         return 0;
     }
+    return (int16_t)raw;
+}
+
+// Быстрое одиночное преобразование для режима пониженного потребления:
+// 860 SPS (~1.2 мс) и опрос бита OS вместо фиксированной задержки в целый тик.
+// Возвращает false при ошибке I2C или таймауте: 0 - допустимое значение отсчёта.
+bool ads1115_read_channel_fast(uint8_t channel, int16_t *value) {
+    ads1115_init_if_needed();
+
+    // MODE = 1 (single-shot): только в нём бит OS сигнализирует о конце преобразования
+    if (ads1115_start_conversion(channel, 0x85E3) != ESP_OK) {
+        return false;
+    }
 
-    return (int16_t)((data[0] << 8) | data[1]);
+    uint16_t config = 0;
+    for (int i = 0; i < 10; i++) {
+        // OS = 1 в регистре конфигурации - преобразование завершено
+        if (ads1115_read_reg(0x01, &config) != ESP_OK) {
+            return false;
+        }
+        if (config & 0x8000) break;
+    }
+    if (!(config & 0x8000)) {
+        ESP_LOGE(TAG_ADS, "ADS1115 conversion timeout on channel %d", channel);
+        return false;
+    }
+
+    uint16_t raw;
+    if (ads1115_read_reg(0x00, &raw) != ESP_OK) {
+        return false;
+    }
+    *value = (int16_t)raw;
+    return true;
 }
 
 #endif
\ No newline at end of file
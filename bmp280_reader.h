@@ -4,6 +4,8 @@
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
+#include "esp_attr.h" // RTC_DATA_ATTR
+#include "esp_rom_sys.h" // esp_rom_delay_us
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <math.h> // Для fmodf, если используется
@@ -38,6 +40,12 @@ typedef struct {
 
 static bmp280_calib_param_t bmp280_calib;
 static bool bmp280_initialized = false; // Флаг инициализации датчика
+static bool bmp280_spi_initialized = false;
+
+// Калибровка для forced mode хранится в RTC-памяти: после пробуждения из deep sleep
+// датчик не нужно сбрасывать и заново читать 24 байта калибровки
+RTC_DATA_ATTR static bmp280_calib_param_t bmp280_calib_rtc;
+RTC_DATA_ATTR static bool bmp280_calib_rtc_valid = false;
 
 // Простая функция чтения одного байта из регистра
 static uint8_t bmp280_spi_read_reg(uint8_t reg) {
@@ -107,9 +115,9 @@ static void bmp280_read_calibration_params() {
 }
 
 
-// Инициализация SPI и BMP280 (вызывается один раз)
-static void bmp280_init() {
-    if (bmp280_initialized) return;
+// Инициализация SPI-шины и устройства BMP280 на ней
+static void bmp280_spi_init() {
+    if (bmp280_spi_initialized) return;
 
     esp_err_t ret;
 
@@ -145,7 +153,15 @@ static void bmp280_init() {
         ESP_ERROR_CHECK(ret); // Остановить выполнение
     }
 
-    ESP_LOGI(TAG_BMP, "SPI initialized");
+    bmp280_spi_initialized = true;
+    ESP_LOGD(TAG_BMP, "SPI initialized"); // Вызывается на каждом пробуждении в LOW_POWER_MODE
+}
+
+// Инициализация SPI и BMP280 (вызывается один раз)
+static void bmp280_init() {
+    if (bmp280_initialized) return;
+
+    bmp280_spi_init();
 
     uint8_t id = bmp280_spi_read_reg(0xD0); // Read ID register
     if (id != 0x58) {
@@ -220,6 +236,21 @@ static uint32_t compensate_pressure_int32(int32_t uncomp_press) {
 }
 
 
+// Чтение сырых данных температуры и давления
+static void bmp280_read_raw(int32_t *uncomp_press, int32_t *uncomp_temp) {
+    // BMP280 выдает 20-битные значения, поэтому объединяем 3 байта
+    *uncomp_press = ((int32_t)bmp280_spi_read_reg(0xF7) << 16) |
+                    ((int32_t)bmp280_spi_read_reg(0xF8) << 8) |
+                    ((int32_t)bmp280_spi_read_reg(0xF9));
+    *uncomp_press >>= 4; // Сырые данные давления имеют 16 бит + 4 младших бита
+
+    *uncomp_temp = ((int32_t)bmp280_spi_read_reg(0xFA) << 16) |
+                   ((int32_t)bmp280_spi_read_reg(0xFB) << 8) |
+                   ((int32_t)bmp280_spi_read_reg(0xFC));
+    *uncomp_temp >>= 4; // Сырые данные температуры имеют 16 бит + 4 младших бита
+}
+
+
 // Новая функция для инициализации и чтения компенсированных данных BMP280
 void bmp280_read_compensated_data(int32_t *temperature, uint32_t *pressure) {
     bmp280_init(); // Убедимся, что датчик инициализирован
@@ -236,17 +267,8 @@ void bmp280_read_compensated_data(int32_t *temperature, uint32_t *pressure) {
     // Если бы был Single-shot mode, нужно было бы ждать установки бита.
     vTaskDelay(100 / portTICK_PERIOD_MS); // Даем время для одного цикла измерения
 
-    // Чтение сырых данных температуры и давления
-    // BMP280 выдает 20-битные значения, поэтому объединяем 3 байта
-    int32_t uncomp_press = ((int32_t)bmp280_spi_read_reg(0xF7) << 16) |
-                           ((int32_t)bmp280_spi_read_reg(0xF8) << 8) |
-                           ((int32_t)bmp280_spi_read_reg(0xF9));
-    uncomp_press >>= 4; // Сырые данные давления имеют 16 бит + 4 младших бита
-
-    int32_t uncomp_temp = ((int32_t)bmp280_spi_read_reg(0xFA) << 16) |
-                          ((int32_t)bmp280_spi_read_reg(0xFB) << 8) |
-                          ((int32_t)bmp280_spi_read_reg(0xFC));
-    uncomp_temp >>= 4; // Сырые данные температуры имеют 16 бит + 4 младших бита
+    int32_t uncomp_press, uncomp_temp;
+    bmp280_read_raw(&uncomp_press, &uncomp_temp);
 
     // Компенсация
     *temperature = compensate_temperature_int32(uncomp_temp);
@@ -265,4 +287,54 @@ void bmp280_read_compensated_data(int32_t *temperature, uint32_t *pressure) {
     // Сейчас *pressure - это Паскали, поэтому для вывода в hPa / 100.0, как в main.c.
 }
 
+// === Одиночное измерение в forced mode (режим пониженного потребления) ===
+// Настройки "weather monitoring" из даташита: oversampling x1/x1, фильтр выключен,
+// измерение ~6.4 мс, после него датчик сам возвращается в sleep.
+// Возвращает false, если датчик не отвечает.
+bool bmp280_read_forced(int32_t *temperature, uint32_t *pressure) {
+    bmp280_spi_init();
+
+    if (!bmp280_calib_rtc_valid) {
+        uint8_t id = bmp280_spi_read_reg(0xD0);
+        if (id != 0x58) {
+            ESP_LOGE(TAG_BMP, "BMP280 Device ID mismatch: 0x%02X (expected 0x58). Check wiring and power.", id);
+            *temperature = 0;
+            *pressure = 0;
+            return false;
+        }
+        bmp280_spi_write_reg(0xE0, 0xB6); // Reset command
+        vTaskDelay(20 / portTICK_PERIOD_MS);
+        bmp280_read_calibration_params();
+        bmp280_spi_write_reg(0xF5, 0x00); // config: filter off, spi3w_en=0
+        bmp280_calib_rtc = bmp280_calib;
+        bmp280_calib_rtc_valid = true;
+    } else {
+        bmp280_calib = bmp280_calib_rtc;
+    }
+
+    bmp280_spi_write_reg(0xF4, 0b00100101); // ctrl_meas: temp x1, press x1, Forced mode
+
+    // Бит measuring (3) может выставиться не сразу после записи ctrl_meas, поэтому сначала
+    // ждём типичное время измерения (даташит: 1 + 2 * osrs_t + 2 * osrs_p + 0.5 = 5.5 мс),
+    // и только потом опрашиваем бит до конца измерения (максимум 6.4 мс).
+    // Задержки активные, а не vTaskDelay: тик при 100 Гц - это 10 мс бодрствования.
+    esp_rom_delay_us(5500);
+    int waited_ms = 0;
+    while (bmp280_spi_read_reg(0xF3) & 0x08) {
+        if (++waited_ms > 15) {
+            ESP_LOGW(TAG_BMP, "BMP280 forced measurement timeout");
+            *temperature = 0;
+            *pressure = 0;
+            return false;
+        }
+        esp_rom_delay_us(1000);
+    }
+
+    int32_t uncomp_press, uncomp_temp;
+    bmp280_read_raw(&uncomp_press, &uncomp_temp);
+    *temperature = compensate_temperature_int32(uncomp_temp);
+    *pressure = compensate_pressure_int32(uncomp_press);
+    return true;
+}
+
 #endif // BMP280_READER_H
\ No newline at end of file
@@ -0,0 +1,232 @@
+#ifndef LOW_POWER_H
+#define LOW_POWER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/time.h>
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_rtc_time.h" // esp_rtc_get_time_us: RTC-таймер идёт и в deep sleep
+#include "esp_wifi.h"
+#include "nvs_flash.h"
+#include "esp_sntp.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "ads1115_reader.h"
+#include "bmp280_reader.h"
+#include "wifi_connect.h"
+#include "uplink.h"
+#include "lp_ring.h"
+
+// === Режим пониженного потребления (батарейный узел) ===
+// Вместо постоянно работающих Wi-Fi и задачи сбора устройство просыпается по таймеру,
+// делает один отсчёт (ADS1115 single-shot 860 SPS, BMP280 в forced mode), дописывает его
+// в кольцо в RTC-памяти и снова уходит в deep sleep. Wi-Fi поднимается только когда кольцо
+// почти заполнено: с BSSID/каналом из RTC-памяти, и всё кольцо уходит через uplink одним
+// пакетом. Неотправленное остаётся в очереди uplink во флеше до следующей выгрузки.
+//
+// Время от пробуждения до сна считается по RTC-таймеру, вместе с ROM-загрузкой и загрузчиком
+// (момент пробуждения - время ухода в сон плюс его длительность, оба в RTC-памяти), и выводится
+// в лог при каждой выгрузке. Загрузку сокращают настройки загрузчика в sdkconfig.defaults.
+
+#ifndef LOW_POWER_MODE
+#define LOW_POWER_MODE 0 // 1 - батарейный узел с deep sleep вместо app_main с веб-сервером
+#endif
+
+#define LP_PERIOD_US (60 * 1000000LL)  // Период отсчётов
+#define LP_WIFI_TIMEOUT_MS 8000
+#define LP_SNTP_TIMEOUT_MS 5000
+#define LP_MIN_SLEEP_US 20000          // Меньше этого не спим, а пропускаем период
+#define LP_TIME_VALID_S 1577836800     // 2020-01-01: раньше - часы не синхронизированы
+
+_Static_assert(LP_RING_CAPACITY <= UPLINK_RAM_CAPACITY, "RTC ring must fit into the uplink RAM queue");
+_Static_assert(LP_RING_CAPACITY <= UPLINK_BATCH_MAX, "RTC ring must fit into one uplink batch");
+
+static const char *TAG_LP = "LOW_POWER";
+
+// Прототип из main.c
+void i2c_bus_init_once();
+
+typedef struct {
+    uint32_t wakes;
+    uint32_t sample_wakes;   // Пробуждения без выгрузки
+    uint32_t flushes;
+    uint32_t flush_failures;
+    uint32_t missed_periods;
+    uint32_t dropped;
+    uint32_t read_failures;  // Отсчёт не записан: датчик не ответил
+    int64_t  boot_last_us;   // От пробуждения до старта приложения (ROM + загрузчик)
+    int64_t  boot_max_us;
+    int64_t  awake_last_us;  // Пробуждение без выгрузки: от пробуждения до сна
+    int64_t  awake_max_us;
+    int64_t  awake_sum_us;
+    int64_t  flush_last_us;  // Выгрузка целиком (Wi-Fi + отправка)
+    int64_t  flush_max_us;
+} lp_stats_t;
+
+RTC_DATA_ATTR static int64_t lp_next_wake_us = 0; // Плановое время текущего отсчёта (UNIX, мкс)
+RTC_DATA_ATTR static lp_ring_t lp_ring;
+RTC_DATA_ATTR static lp_stats_t lp_stats;
+RTC_DATA_ATTR static uint64_t lp_sleep_rtc_us = 0;   // RTC-время ухода в сон
+RTC_DATA_ATTR static uint64_t lp_sleep_len_us = 0;   // Заказанная длительность сна
+
+static int64_t lp_now_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// Синхронизация часов по SNTP при каждом подключении: RTC-таймер в deep sleep уходит
+// на секунды в сутки. Ждём именно завершения синхронизации, а не года >= 2020.
+static bool lp_sync_time(void) {
+    if (!esp_sntp_enabled()) {
+        esp_sntp_setoperatingmode(SNTP_OPMODE_POLL);
+        esp_sntp_setservername(0, "pool.ntp.org");
+        esp_sntp_init();
+    }
+    for (int waited = 0; sntp_get_sync_status() != SNTP_SYNC_STATUS_COMPLETED; waited += 100) {
+        if (waited >= LP_SNTP_TIMEOUT_MS) {
+            ESP_LOGW(TAG_LP, "SNTP sync timeout");
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    return true;
+}
+
+// Выгрузка кольца через uplink. need_time - часы не синхронизированы, поэтому Wi-Fi
+// поднимается даже без настроенного адреса выгрузки.
+static void lp_flush(bool need_time) {
+    int64_t start = esp_timer_get_time();
+
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+
+    // Кольцо переносится в очередь uplink: там номера, сжатие и очередь во флеше
+    uplink_load_state();
+    uplink_period_ms = LP_PERIOD_US / 1000;
+    uplink_batch_size = LP_RING_CAPACITY; // Всё кольцо - одним пакетом
+    for (int i = 0; i < lp_ring.count; i++) {
+        const lp_sample_t *s = lp_ring_at(&lp_ring, i);
+        uplink_sample_t sample = {
+            .t_ms = lp_ring.base_ms + s->t_ofs_ms,
+            .a0 = s->a0,
+            .a1 = s->a1,
+            .temp = s->temp,
+            .press = (uint32_t)s->press_ofs + LP_PRESS_BASE,
+        };
+        uplink_push(&sample);
+    }
+    uplink_save_seq(); // Номера уже присвоены: после сбоя они не повторятся
+
+    bool wifi_started = uplink_url[0] != '\0' || need_time;
+    bool connected = false;
+    if (wifi_started) {
+        connected = wifi_connect_cached(LP_WIFI_TIMEOUT_MS);
+        if (connected) {
+            lp_sync_time();
+        }
+    }
+
+    // Без адреса выгрузки Wi-Fi поднимался только ради часов: это не сбой выгрузки
+    bool upload = uplink_url[0] != '\0';
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+    if (connected && upload) {
+        while ((err = uplink_send_next(true)) == ESP_OK) {
+        }
+    }
+    bool failed = upload && err != ESP_ERR_NOT_FOUND;
+    if (failed) {
+        lp_stats.flush_failures++;
+    }
+    uplink_spill_if_needed(1); // Всё неотправленное - во флеш, до следующей выгрузки
+    // В кольце остаётся только то, что не подтверждено и не записалось во флеш
+    lp_ring_keep_newest(&lp_ring, uplink_ram_queued());
+    uplink_transport_reset();
+    if (wifi_started) {
+        esp_wifi_stop();
+    }
+
+    int64_t took = esp_timer_get_time() - start;
+    lp_stats.flushes++;
+    lp_stats.flush_last_us = took;
+    if (took > lp_stats.flush_max_us) lp_stats.flush_max_us = took;
+    ESP_LOGI(TAG_LP, "Flush %s in %lld ms, %d sample(s) kept in RTC. Wakes: %lu, boot last/max: %lld/%lld us, "
+             "awake last/mean/max: %lld/%lld/%lld us, missed periods: %lu, dropped: %lu, read failures: %lu",
+             !upload ? "skipped (no uplink URL)" : failed ? "failed" : "done", (long long)(took / 1000),
+             lp_ring.count, (unsigned long)lp_stats.wakes, (long long)lp_stats.boot_last_us,
+             (long long)lp_stats.boot_max_us, (long long)lp_stats.awake_last_us,
+             (long long)(lp_stats.sample_wakes ? lp_stats.awake_sum_us / lp_stats.sample_wakes : 0),
+             (long long)lp_stats.awake_max_us, (unsigned long)lp_stats.missed_periods,
+             (unsigned long)lp_stats.dropped, (unsigned long)lp_stats.read_failures);
+}
+
+// Один цикл пробуждения: отсчёт, при необходимости выгрузка, deep sleep. Не возвращается.
+void low_power_run(void) {
+    bool flushed = false;
+
+    // Момент пробуждения по RTC-таймеру; после холодного старта - старт приложения
+    uint64_t wake_rtc_us = esp_rtc_get_time_us() - (uint64_t)esp_timer_get_time();
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER && lp_sleep_len_us != 0) {
+        wake_rtc_us = lp_sleep_rtc_us + lp_sleep_len_us;
+        int64_t boot = (int64_t)(esp_rtc_get_time_us() - wake_rtc_us) - esp_timer_get_time();
+        lp_stats.boot_last_us = boot;
+        if (boot > lp_stats.boot_max_us) lp_stats.boot_max_us = boot;
+    }
+
+    // Холодный старт без синхронизированных часов: отсчётам не к чему привязать время.
+    // Если синхронизация не удалась, повторная попытка будет только при выгрузке.
+    if (lp_stats.wakes == 0 && lp_now_us() / 1000000 < LP_TIME_VALID_S) {
+        lp_flush(true);
+        flushed = true;
+    }
+
+    int64_t now = lp_now_us();
+    lp_next_wake_us = lp_schedule_current(lp_next_wake_us, now, LP_PERIOD_US);
+
+    i2c_bus_init_once();
+    int16_t a0 = 0, a1 = 0;
+    int32_t temp = 0;
+    uint32_t press = 0;
+    bool ok = ads1115_read_channel_fast(0, &a0);
+    ok = ads1115_read_channel_fast(1, &a1) && ok;
+    ok = bmp280_read_forced(&temp, &press) && ok;
+    if (!ok) {
+        // Нули вместо показаний выглядели бы как настоящий отсчёт: период остаётся пропуском
+        lp_stats.read_failures++;
+    } else if (lp_ring_append(&lp_ring, lp_next_wake_us / 1000, a0, a1, temp, press)) {
+        // Плановое время, а не фактическое: период в данных точный
+        lp_stats.dropped++;
+    }
+
+    if (lp_ring_should_flush(&lp_ring)) {
+        lp_flush(lp_now_us() / 1000000 < LP_TIME_VALID_S);
+        flushed = true;
+    }
+
+    now = lp_now_us();
+    int64_t next = lp_schedule_next(lp_next_wake_us, now, LP_PERIOD_US, LP_MIN_SLEEP_US, &lp_stats.missed_periods);
+    lp_next_wake_us = next;
+
+    int64_t awake = (int64_t)(esp_rtc_get_time_us() - wake_rtc_us);
+    lp_stats.wakes++;
+    if (!flushed) {
+        lp_stats.sample_wakes++;
+        lp_stats.awake_last_us = awake;
+        lp_stats.awake_sum_us += awake;
+        if (awake > lp_stats.awake_max_us) lp_stats.awake_max_us = awake;
+    }
+
+    lp_sleep_len_us = (uint64_t)(next - now);
+    lp_sleep_rtc_us = esp_rtc_get_time_us();
+    esp_sleep_enable_timer_wakeup(lp_sleep_len_us);
+    esp_deep_sleep_start();
+}
+
+#endif // LOW_POWER_H
@@ -0,0 +1,90 @@
+#ifndef LP_RING_H
+#define LP_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// === Логика циклов пробуждения режима пониженного потребления ===
+// Кольцо отсчётов, расписание пробуждений и порог выгрузки без зависимостей от ESP-IDF:
+// low_power.h держит состояние в RTC-памяти, а последовательность пробуждений
+// проверяется на хосте (test/test_lp_ring.c).
+
+#define LP_RING_CAPACITY 120           // Отсчётов в RTC-памяти (2 часа при периоде 60 с)
+#define LP_FLUSH_LEVEL (LP_RING_CAPACITY * 9 / 10) // С этого уровня выгружаем
+#define LP_PRESS_BASE 50000            // Давление хранится как смещение от 500 гПа
+
+// Компактный отсчёт для RTC-памяти (12 байт)
+typedef struct {
+    uint32_t t_ofs_ms;  // От base_ms кольца
+    int16_t  a0;
+    int16_t  a1;
+    int16_t  temp;      // °C * 100
+    uint16_t press_ofs; // Па - LP_PRESS_BASE
+} lp_sample_t;
+
+typedef struct {
+    int64_t     base_ms;  // Время, от которого отсчитываются t_ofs_ms
+    lp_sample_t samples[LP_RING_CAPACITY];
+    uint16_t    head;     // Индекс следующей записи
+    uint16_t    count;
+} lp_ring_t;
+
+// Добавление отсчёта. true - кольцо было заполнено и старейший отсчёт вытеснен.
+static bool lp_ring_append(lp_ring_t *r, int64_t t_ms, int16_t a0, int16_t a1, int32_t temp, uint32_t press) {
+    bool dropped = false;
+    if (r->count == 0) {
+        r->base_ms = t_ms;
+    } else if (r->count == LP_RING_CAPACITY) {
+        r->count--; // Выгрузка не удалась и флеш недоступен: вытесняем старейший
+        dropped = true;
+    }
+    int32_t p = (int32_t)press - LP_PRESS_BASE;
+    r->samples[r->head] = (lp_sample_t){
+        .t_ofs_ms = (uint32_t)(t_ms - r->base_ms),
+        .a0 = a0,
+        .a1 = a1,
+        .temp = (int16_t)temp,
+        .press_ofs = (uint16_t)(p < 0 ? 0 : p > UINT16_MAX ? UINT16_MAX : p),
+    };
+    r->head = (r->head + 1) % LP_RING_CAPACITY;
+    r->count++;
+    return dropped;
+}
+
+// i-й отсчёт, считая от старейшего
+static const lp_sample_t *lp_ring_at(const lp_ring_t *r, int i) {
+    return &r->samples[(r->head - r->count + i + LP_RING_CAPACITY) % LP_RING_CAPACITY];
+}
+
+// Оставить только n новейших отсчётов (остальные выгружены или ушли во флеш)
+static void lp_ring_keep_newest(lp_ring_t *r, int n) {
+    if (n < 0) n = 0;
+    if (n < r->count) r->count = (uint16_t)n;
+}
+
+static bool lp_ring_should_flush(const lp_ring_t *r) {
+    return r->count >= LP_FLUSH_LEVEL;
+}
+
+// Плановое время текущего отсчёта. Расписание начинается заново при первом запуске
+// (planned_us == 0) и если часы переставлены больше чем на период в любую сторону.
+static int64_t lp_schedule_current(int64_t planned_us, int64_t now_us, int64_t period_us) {
+    if (planned_us == 0 || now_us - planned_us > period_us || now_us < planned_us - period_us) {
+        return now_us;
+    }
+    return planned_us;
+}
+
+// Следующее пробуждение - от планового времени текущего, чтобы время бодрствования не копилось.
+// Если до него меньше min_sleep_us, периоды пропускаются; их число добавляется к *missed.
+static int64_t lp_schedule_next(int64_t current_us, int64_t now_us, int64_t period_us,
+                                int64_t min_sleep_us, uint32_t *missed) {
+    int64_t next = current_us + period_us;
+    while (next - now_us < min_sleep_us) {
+        next += period_us;
+        (*missed)++;
+    }
+    return next;
+}
+
+#endif // LP_RING_H
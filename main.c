@@ -9,6 +9,10 @@
 #include "i2c_scanner.h"
 #include "esp_http_server.h"
 #include "wifi_connect.h"
+#include "acq_scheduler.h"
+#include "rules_engine.h"
+#include "uplink.h"
+#include "low_power.h"
 
 // Добавим прототип для i2c_init, чтобы инициализировать I2C централизованно
 // Это необходимо, чтобы i2c_scanner мог работать, если ads1115_init_if_needed() еще не вызван
@@ -83,32 +87,144 @@ esp_err_t i2c_scan_handler(httpd_req_t *req) {
 
 // === Обработчик HTTP-запроса к /sensors ===
 esp_err_t sensor_handler(httpd_req_t *req) {
-    // Внимание: ads1115_init_if_needed() будет вызвана внутри ads1115_read_channel().
-    // Если I2C уже инициализирован в app_main, она просто вернется.
-    int16_t ch0 = ads1115_read_channel(0);
-    int16_t ch1 = ads1115_read_channel(1);
-
-    int32_t temperature_comp;
-    uint32_t pressure_comp;
-    // Используем новую функцию для чтения BMP280, которая включает компенсацию
-    bmp280_read_compensated_data(&temperature_comp, &pressure_comp);
+    // Датчики опрашивает только задача сбора на APP_CPU, здесь отдаём её последний отсчёт,
+    // чтобы httpd не занимал шины I2C/SPI и не сбивал период опроса.
+    acq_sample_t s;
+    if (!acq_get_latest(&s)) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_send(req, "No samples yet", HTTPD_RESP_USE_STRLEN);
+        return ESP_OK;
+    }
 
     char response[200];
     // Делим на 100.0, так как функции чтения BMP280 будут возвращать значения с двумя знаками после запятой
     snprintf(response, sizeof(response),
-             "{\"A0\": %d, \"A1\": %d, \"temp\": %.2f, \"press\": %.2f}",
-             ch0, ch1, (float)temperature_comp / 100.0, (float)pressure_comp / 100.0);
+             "{\"A0\": %d, \"A1\": %d, \"temp\": %.2f, \"press\": %.2f, \"seq\": %lu, \"age_ms\": %lld}",
+             s.a0, s.a1, (float)s.temp / 100.0, (float)s.press / 100.0,
+             (unsigned long)s.seq, (long long)((esp_timer_get_time() - s.t_us) / 1000));
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, response, HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+// === Обработчик HTTP-запроса к /acq_stats ===
+esp_err_t acq_stats_handler(httpd_req_t *req) {
+    char response[384];
+    acq_stats_to_json(response, sizeof(response));
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, response, HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+// === Чтение тела POST-запроса в строку ===
+static esp_err_t read_request_body(httpd_req_t *req, char *buf, size_t maxlen) {
+    if (req->content_len >= maxlen) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Body too large");
+        return ESP_FAIL;
+    }
+    size_t received = 0;
+    while (received < req->content_len) {
+        int ret = httpd_req_recv(req, buf + received, req->content_len - received);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (ret <= 0) {
+            return ESP_FAIL;
+        }
+        received += ret;
+    }
+    buf[received] = '\0';
+    return ESP_OK;
+}
+
+// === Обработчик HTTP-запроса к /rules (GET) ===
+// Правила отдаются по частям: полный список не помещается в буфер на стеке httpd
+esp_err_t rules_get_handler(httpd_req_t *req) {
+    static rules_snapshot_t snap; // httpd обрабатывает запросы в одной задаче
+    char chunk[RULES_JSON_ENTRY_MAX];
+    rules_get_snapshot(&snap);
+
+    httpd_resp_set_type(req, "application/json");
+    rules_snapshot_header_json(&snap, chunk, sizeof(chunk));
+    httpd_resp_send_chunk(req, chunk, HTTPD_RESP_USE_STRLEN);
+    for (int i = 0; i < snap.count; i++) {
+        rules_snapshot_rule_json(&snap, i, chunk, sizeof(chunk));
+        httpd_resp_send_chunk(req, chunk, HTTPD_RESP_USE_STRLEN);
+    }
+    httpd_resp_send_chunk(req, "]}", HTTPD_RESP_USE_STRLEN);
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+// === Обработчик HTTP-запроса к /rules (POST): новый текст правил ===
+esp_err_t rules_post_handler(httpd_req_t *req) {
+    char text[RULES_TEXT_MAX];
+    if (read_request_body(req, text, sizeof(text)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    if (rules_set_text(text, true) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid rules");
+        return ESP_OK;
+    }
+    return rules_get_handler(req);
+}
+
+// === Обработчик HTTP-запроса к /rules_webhook (POST): URL для событий ===
+esp_err_t rules_webhook_handler(httpd_req_t *req) {
+    char url[RULES_URL_MAX];
+    if (read_request_body(req, url, sizeof(url)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    esp_err_t err = rules_set_webhook(url);
+    if (err == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid webhook URL");
+        return ESP_OK;
+    }
+    if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save webhook");
+        return ESP_OK;
+    }
+    httpd_resp_send(req, "OK", HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
 
+// === Обработчик HTTP-запроса к /uplink (GET) ===
+esp_err_t uplink_get_handler(httpd_req_t *req) {
+    static char response[UPLINK_JSON_MAX]; // httpd обрабатывает запросы в одной задаче
+    uplink_stats_to_json(response, sizeof(response));
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, response, HTTPD_RESP_USE_STRLEN);
     return ESP_OK;
 }
 
+// === Обработчик HTTP-запроса к /uplink (POST): "<url>[\n<топик MQTT>]" ===
+esp_err_t uplink_post_handler(httpd_req_t *req) {
+    char body[UPLINK_URL_MAX + UPLINK_TOPIC_MAX];
+    if (read_request_body(req, body, sizeof(body)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    char *topic = strchr(body, '\n');
+    if (topic) {
+        *topic++ = '\0';
+        topic[strcspn(topic, "\r\n")] = '\0';
+    }
+    body[strcspn(body, "\r")] = '\0';
+    if (uplink_set_config(body, (topic && *topic) ? topic : NULL) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid uplink config");
+        return ESP_OK;
+    }
+    return uplink_get_handler(req);
+}
+
 // === Запуск Web-сервера ===
 void start_web_server() {
     httpd_handle_t server = NULL;
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.stack_size = 4096; // Увеличить размер стека для HTTPD, если возникают проблемы
+    config.core_id = NET_TASK_CORE; // Сеть на PRO_CPU, APP_CPU остаётся за задачей сбора
+    config.task_priority = HTTPD_TASK_PRIORITY;
+    config.max_uri_handlers = 12;
 
     if (httpd_start(&server, &config) == ESP_OK) {
         ESP_LOGI("HTTP", "Server started on port %d", config.server_port); // Исправлено: config.server_port вместо config.uri_match_fn
@@ -131,10 +247,52 @@ void start_web_server() {
             .handler   = i2c_scan_handler,
             .user_ctx  = NULL
         };
+        httpd_uri_t acq_stats_uri = {
+            .uri       = "/acq_stats",
+            .method    = HTTP_GET,
+            .handler   = acq_stats_handler,
+            .user_ctx  = NULL
+        };
+        httpd_uri_t rules_get_uri = {
+            .uri       = "/rules",
+            .method    = HTTP_GET,
+            .handler   = rules_get_handler,
+            .user_ctx  = NULL
+        };
+        httpd_uri_t rules_post_uri = {
+            .uri       = "/rules",
+            .method    = HTTP_POST,
+            .handler   = rules_post_handler,
+            .user_ctx  = NULL
+        };
+        httpd_uri_t rules_webhook_uri = {
+            .uri       = "/rules_webhook",
+            .method    = HTTP_POST,
+            .handler   = rules_webhook_handler,
+            .user_ctx  = NULL
+        };
+        httpd_uri_t uplink_get_uri = {
+            .uri       = "/uplink",
+            .method    = HTTP_GET,
+            .handler   = uplink_get_handler,
+            .user_ctx  = NULL
+        };
+        httpd_uri_t uplink_post_uri = {
+            .uri       = "/uplink",
+            .method    = HTTP_POST,
+            .handler   = uplink_post_handler,
+            .user_ctx  = NULL
+        };
 
         httpd_register_uri_handler(server, &i2c_scan_uri);
         httpd_register_uri_handler(server, &time_uri);
         httpd_register_uri_handler(server, &sensors_uri);
+        httpd_register_uri_handler(server, &acq_stats_uri);
+        httpd_register_uri_handler(server, &rules_get_uri);
+        httpd_register_uri_handler(server, &rules_post_uri);
+        httpd_register_uri_handler(server, &rules_webhook_uri);
+        httpd_register_uri_handler(server, &uplink_get_uri);
+        httpd_register_uri_handler(server, &uplink_post_uri);
     } else {
         ESP_LOGE("HTTP", "Failed to start server!");
     }
@@ -172,9 +330,20 @@ void i2c_bus_init_once() {
     ESP_LOGI(TAG_MAIN, "I2C master driver initialized.");
 }
 
+// === Вывод отсчётов в консоль ===
+// Если вам не нужен постоянный вывод в консоль, уберите регистрацию в app_main.
+static void console_sink(const acq_sample_t *s, void *ctx) {
+    printf("CH0: %d | CH1: %d\n", s->a0, s->a1);
+    printf("TEMP: %.2f C | PRESS: %.2f hPa\n", (float)s->temp / 100.0, (float)s->press / 100.0);
+}
 
 // === Точка входа ===
 void app_main(void) {
+#if LOW_POWER_MODE
+    // Батарейный узел: один отсчёт за пробуждение, затем deep sleep (функция не возвращается)
+    low_power_run();
+#endif
+
     // 1. Инициализация NVS
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -192,24 +361,15 @@ void app_main(void) {
     // 4. Получение времени через SNTP
     obtain_time();
 
-    // 5. Запуск веб-сервера
-    start_web_server();
-
-    // Основной цикл приложения (если нужны какие-то периодические действия, кроме веб-сервера)
-    // Веб-сервер и другие задачи FreeRTOS будут работать в фоновом режиме.
-    while (1) {
-        // Пример: Вывод данных ADS1115 в консоль каждые 5 секунд
-        // Если вам не нужен постоянный вывод в консоль, можно удалить или изменить эту часть.
-        int16_t val0 = ads1115_read_channel(0);
-        int16_t val1 = ads1115_read_channel(1);
-        printf("CH0: %d | CH1: %d\n", val0, val1);
+    // 5. Правила и очередь выгрузки (до веб-сервера: их обработчики обращаются к ним)
+    ESP_ERROR_CHECK(rules_init()); // Правила проверяются на каждом отсчёте
+    ESP_ERROR_CHECK(uplink_init()); // Отсчёты копятся в очереди и уходят пакетами
 
-        // Пример: Вывод данных BMP280 в консоль
-        int32_t temperature_console;
-        uint32_t pressure_console;
-        bmp280_read_compensated_data(&temperature_console, &pressure_console);
-        printf("TEMP: %.2f C | PRESS: %.2f hPa\n", (float)temperature_console / 100.0, (float)pressure_console / 100.0);
+    // 6. Запуск веб-сервера
+    start_web_server();
 
-        vTaskDelay(pdMS_TO_TICKS(5000)); // Задержка 5 секунд
-    }
-}
\ No newline at end of file
+    // 7. Запуск периодического сбора данных на APP_CPU
+    // Вывод в консоль теперь идёт из задачи сбора, app_main может завершиться.
+    acq_register_sink(console_sink, NULL);
+    ESP_ERROR_CHECK(acq_scheduler_start());
+}
@@ -0,0 +1,525 @@
+#ifndef RULES_ENGINE_H
+#define RULES_ENGINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_log.h"
+#include "esp_http_client.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "acq_scheduler.h"
+
+// === Движок правил ===
+// Правила проверяются на каждом новом отсчёте прямо в задаче сбора, а события
+// (срабатывание/сброс) уходят в очередь, которую на PRO_CPU разбирает задача webhook.
+// Так устройство само сообщает об отклонениях, и опрашивать /sensors не нужно.
+//
+// Текст правил хранится в NVS (пространство "rules", ключ "rules"), правила
+// разделяются ';' или переводом строки:
+//   <имя> <метрика> <вид> <'>'|'<'> <порог> [hyst <гистерезис>] [win <окно>]
+// Метрики: a0, a1 (сырые отсчёты ADS1115), temp (°C * 100), press (Па).
+// Виды: val - текущее значение, roc - скорость изменения за окно (единиц в минуту),
+//       min / max / mean - по последним <окно> отсчётам.
+// Имя правила - латинские буквы, цифры, '_' и '-' (попадает в JSON без экранирования).
+// Пример: "dry_soil a0 val > 20000 hyst 500; press_drop press roc < -50 win 12"
+//
+// URL webhook хранится там же (ключ "webhook"). Для проверки подойдёт любой локальный
+// HTTP-сервер, принимающий POST, например: http://192.168.1.10:8080/alerts
+
+#define RULES_MAX 16
+#define RULES_NAME_LEN 16
+#define RULES_WINDOW_MAX 64        // Глубина истории отсчётов (5 мин при периоде 5 с)
+#define RULES_TEXT_MAX 512
+#define RULES_URL_MAX 128
+#define RULES_EVENT_QUEUE_LEN 16
+#define RULES_NOTIFY_STACK_SIZE 4096
+#define RULES_NOTIFY_PRIORITY (tskIDLE_PRIORITY + 4)
+#define RULES_LOCK_TIMEOUT_MS 50
+
+static const char *TAG_RULES = "RULES";
+
+typedef enum { RULE_M_A0, RULE_M_A1, RULE_M_TEMP, RULE_M_PRESS, RULE_M_COUNT } rule_metric_t;
+typedef enum { RULE_K_VAL, RULE_K_ROC, RULE_K_MIN, RULE_K_MAX, RULE_K_MEAN } rule_kind_t;
+
+static const char *const rule_metric_names[] = { "a0", "a1", "temp", "press" };
+static const char *const rule_kind_names[] = { "val", "roc", "min", "max", "mean" };
+
+// Скомпилированное правило. Условие '<' приводится к '>' сменой знака (sign = -1),
+// порог сброса с учётом гистерезиса считается заранее, так что проверка сводится
+// к одному умножению и двум сравнениям. Агрегаты окна для min / max / mean тоже
+// не пересчитываются по всему окну, а обновляются на каждом отсчёте (rule_agg_t).
+typedef struct {
+    uint8_t metric;
+    uint8_t kind;
+    uint8_t window;
+    int8_t  sign;
+    int32_t on;    // Срабатывание: sign * x > on
+    int32_t off;   // Сброс:        sign * x <= off
+    char    name[RULES_NAME_LEN];
+} rule_t;
+
+// Имя и порог копируются в событие при срабатывании: пока событие ждёт в очереди,
+// таблицу правил могут заменить
+typedef struct {
+    bool     firing;
+    int32_t  value;
+    int32_t  threshold;
+    uint32_t seq;
+    time_t   time;
+    char     name[RULES_NAME_LEN];
+} rule_event_t;
+
+// Агрегат окна правила: сумма для mean, монотонная очередь номеров отсчётов для min / max
+// (значения по очереди не убывают для min и не возрастают для max, экстремум - в начале)
+typedef struct {
+    int64_t  sum;
+    uint16_t dq[RULES_WINDOW_MAX];
+    uint8_t  dq_head;
+    uint8_t  dq_len;
+} rule_agg_t;
+
+static rule_t rules_table[RULES_MAX];
+static int rules_count = 0;
+static uint32_t rules_firing = 0; // Битовая маска сработавших правил
+static uint32_t rules_dropped_events = 0;
+static SemaphoreHandle_t rules_mutex = NULL;
+static QueueHandle_t rules_event_queue = NULL;
+static char rules_webhook_url[RULES_URL_MAX] = "";
+static uint32_t rules_generation = 0; // Меняется при каждой замене таблицы
+
+// История отсчётов для оконных правил (используется только задачей сбора)
+static int32_t rules_hist[RULE_M_COUNT][RULES_WINDOW_MAX];
+static int64_t rules_hist_t[RULES_WINDOW_MAX];
+static int rules_hist_head = 0;  // Индекс следующей записи, всегда rules_hist_n % RULES_WINDOW_MAX
+static int rules_hist_count = 0;
+static uint16_t rules_hist_n = 0; // Номер следующего отсчёта; для возрастов <= окна переполнение не мешает
+
+// Агрегаты окон (только задача сбора) и поколение таблицы, для которого они посчитаны
+static rule_agg_t rules_agg[RULES_MAX];
+static uint32_t rules_agg_generation = 0;
+static bool rules_agg_valid = false;
+
+static int rules_lookup(const char *tok, const char *const *names, int n) {
+    for (int i = 0; i < n; i++) {
+        if (strcmp(tok, names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+static bool rules_parse_int(const char *tok, int32_t *out) {
+    if (tok == NULL) return false;
+    char *end;
+    long v = strtol(tok, &end, 10);
+    if (*tok == '\0' || *end != '\0') return false;
+    *out = (int32_t)v;
+    return true;
+}
+
+// Имя правила: [A-Za-z0-9_-]
+static bool rules_valid_name(const char *name) {
+    for (const char *c = name; *c; c++) {
+        if (!((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') ||
+              *c == '_' || *c == '-')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// URL webhook выводится в JSON /rules как есть: без кавычек, '\\', пробелов и управляющих символов
+static bool rules_valid_url(const char *url) {
+    for (const char *c = url; *c; c++) {
+        if ((unsigned char)*c <= ' ' || *c == '"' || *c == '\\' || *c == 0x7F) return false;
+    }
+    return true;
+}
+
+// Разбор одного правила; line изменяется (strtok_r)
+static bool rules_compile_one(char *line, rule_t *r) {
+    char *save;
+    char *name = strtok_r(line, " \t", &save);
+    char *metric = strtok_r(NULL, " \t", &save);
+    char *kind = strtok_r(NULL, " \t", &save);
+    char *op = strtok_r(NULL, " \t", &save);
+    char *thr = strtok_r(NULL, " \t", &save);
+
+    int m = metric ? rules_lookup(metric, rule_metric_names, RULE_M_COUNT) : -1;
+    int k = kind ? rules_lookup(kind, rule_kind_names, sizeof(rule_kind_names) / sizeof(rule_kind_names[0])) : -1;
+    int32_t threshold, hyst = 0, window = 1;
+    if (name == NULL || !rules_valid_name(name) || m < 0 || k < 0 || op == NULL || (strcmp(op, ">") != 0 && strcmp(op, "<") != 0) ||
+        !rules_parse_int(thr, &threshold)) {
+        return false;
+    }
+
+    char *opt;
+    while ((opt = strtok_r(NULL, " \t", &save)) != NULL) {
+        char *arg = strtok_r(NULL, " \t", &save);
+        if (strcmp(opt, "hyst") == 0) {
+            if (!rules_parse_int(arg, &hyst) || hyst < 0) return false;
+        } else if (strcmp(opt, "win") == 0) {
+            if (!rules_parse_int(arg, &window)) return false;
+        } else {
+            return false;
+        }
+    }
+    // Для roc окно - расстояние до старого отсчёта, поэтому нужен ещё один отсчёт истории
+    int32_t window_max = (k == RULE_K_ROC) ? RULES_WINDOW_MAX - 1 : RULES_WINDOW_MAX;
+    if (window < 1 || window > window_max) return false;
+
+    memset(r, 0, sizeof(*r));
+    strncpy(r->name, name, RULES_NAME_LEN - 1);
+    r->metric = (uint8_t)m;
+    r->kind = (uint8_t)k;
+    r->window = (uint8_t)window;
+    r->sign = (op[0] == '>') ? 1 : -1;
+    r->on = r->sign * threshold;
+    r->off = r->on - hyst;
+    return true;
+}
+
+// Компиляция текста правил в таблицу. При ошибке таблица не меняется.
+static esp_err_t rules_compile(const char *text, rule_t *out, int *count) {
+    char buf[RULES_TEXT_MAX];
+    if (strlen(text) >= sizeof(buf)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    strcpy(buf, text);
+
+    int n = 0;
+    char *save;
+    for (char *line = strtok_r(buf, ";\n", &save); line != NULL; line = strtok_r(NULL, ";\n", &save)) {
+        if (strspn(line, " \t\r") == strlen(line)) continue; // Пустая строка
+        if (n >= RULES_MAX) {
+            ESP_LOGE(TAG_RULES, "Too many rules (max %d)", RULES_MAX);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        char *cr = strchr(line, '\r');
+        if (cr) *cr = '\0';
+        if (!rules_compile_one(line, &out[n])) {
+            ESP_LOGE(TAG_RULES, "Syntax error in rule #%d", n + 1);
+            return ESP_ERR_INVALID_ARG;
+        }
+        n++;
+    }
+    *count = n;
+    return ESP_OK;
+}
+
+// Добавление в агрегат правила отсчёта с номером sn (уже записанного в историю)
+static void rules_agg_push(const rule_t *r, rule_agg_t *a, uint16_t sn) {
+    const int32_t *h = rules_hist[r->metric];
+    int32_t v = h[sn % RULES_WINDOW_MAX];
+    if (r->kind == RULE_K_MEAN) {
+        a->sum += v;
+        return;
+    }
+    // Сначала уходят отсчёты старше окна, тогда очередь не длиннее окна
+    while (a->dq_len > 0 && (uint16_t)(sn - a->dq[a->dq_head]) >= r->window) {
+        a->dq_head = (a->dq_head + 1) % RULES_WINDOW_MAX;
+        a->dq_len--;
+    }
+    // С конца уходят отсчёты, которые при новом уже не станут экстремумом
+    while (a->dq_len > 0) {
+        int32_t back = h[a->dq[(a->dq_head + a->dq_len - 1) % RULES_WINDOW_MAX] % RULES_WINDOW_MAX];
+        if (r->kind == RULE_K_MIN ? back < v : back > v) break;
+        a->dq_len--;
+    }
+    a->dq[(a->dq_head + a->dq_len) % RULES_WINDOW_MAX] = sn;
+    a->dq_len++;
+}
+
+// Пересчёт агрегатов по истории: после замены таблицы или пропущенного отсчёта
+static void rules_agg_rebuild(void) {
+    memset(rules_agg, 0, sizeof(rules_agg));
+    for (int i = 0; i < rules_count; i++) {
+        const rule_t *r = &rules_table[i];
+        if (r->kind < RULE_K_MIN) continue;
+        int k = rules_hist_count < r->window ? rules_hist_count : r->window;
+        for (int j = k; j > 0; j--) {
+            rules_agg_push(r, &rules_agg[i], (uint16_t)(rules_hist_n - j));
+        }
+    }
+    rules_agg_generation = rules_generation;
+    rules_agg_valid = true;
+}
+
+// Значение метрики для правила; false, если истории для окна ещё недостаточно
+static bool rules_metric_value(const rule_t *r, const rule_agg_t *a, int32_t *out) {
+    const int32_t *h = rules_hist[r->metric];
+    int newest = (rules_hist_head + RULES_WINDOW_MAX - 1) % RULES_WINDOW_MAX;
+
+    switch (r->kind) {
+        case RULE_K_VAL:
+            *out = h[newest];
+            return true;
+        case RULE_K_ROC: {
+            if (rules_hist_count <= r->window) return false;
+            int old = (newest + RULES_WINDOW_MAX - r->window) % RULES_WINDOW_MAX;
+            int64_t dt = rules_hist_t[newest] - rules_hist_t[old];
+            if (dt <= 0) return false;
+            *out = (int32_t)(((int64_t)(h[newest] - h[old]) * 60000000LL) / dt);
+            return true;
+        }
+        case RULE_K_MEAN:
+            if (rules_hist_count < r->window) return false;
+            *out = (int32_t)(a->sum / r->window);
+            return true;
+        default: // min / max: экстремум окна в начале очереди
+            if (rules_hist_count < r->window) return false;
+            *out = h[a->dq[a->dq_head] % RULES_WINDOW_MAX];
+            return true;
+    }
+}
+
+// Получатель отсчётов для acq_scheduler: обновляет историю и проверяет правила
+static void rules_sink(const acq_sample_t *s, void *ctx) {
+    // Мьютекс держат только на время копирования таблицы, так что короткого ожидания хватает
+    bool locked = xSemaphoreTake(rules_mutex, pdMS_TO_TICKS(RULES_LOCK_TIMEOUT_MS)) == pdTRUE;
+    bool incremental = locked && rules_agg_valid && rules_agg_generation == rules_generation;
+
+    // Сумма mean: вычитаем отсчёт, выходящий из окна, пока он не перезаписан новым
+    if (incremental) {
+        for (int i = 0; i < rules_count; i++) {
+            const rule_t *r = &rules_table[i];
+            if (r->kind == RULE_K_MEAN && rules_hist_count >= r->window) {
+                rules_agg[i].sum -= rules_hist[r->metric][(uint16_t)(rules_hist_n - r->window) % RULES_WINDOW_MAX];
+            }
+        }
+    }
+
+    rules_hist[RULE_M_A0][rules_hist_head] = s->a0;
+    rules_hist[RULE_M_A1][rules_hist_head] = s->a1;
+    rules_hist[RULE_M_TEMP][rules_hist_head] = s->temp;
+    rules_hist[RULE_M_PRESS][rules_hist_head] = (int32_t)s->press;
+    rules_hist_t[rules_hist_head] = s->t_sched_us; // Плановое время: период точный
+    rules_hist_head = (rules_hist_head + 1) % RULES_WINDOW_MAX;
+    uint16_t sn = rules_hist_n++;
+    if (rules_hist_count < RULES_WINDOW_MAX) rules_hist_count++;
+
+    if (!locked) {
+        rules_agg_valid = false; // Агрегаты пересчитаются по истории на следующем отсчёте
+        ESP_LOGW(TAG_RULES, "Rules table busy, sample %lu not evaluated", (unsigned long)s->seq);
+        return;
+    }
+    if (incremental) {
+        for (int i = 0; i < rules_count; i++) {
+            if (rules_table[i].kind >= RULE_K_MIN) rules_agg_push(&rules_table[i], &rules_agg[i], sn);
+        }
+    } else {
+        rules_agg_rebuild();
+    }
+
+    for (int i = 0; i < rules_count; i++) {
+        const rule_t *r = &rules_table[i];
+        int32_t value;
+        if (!rules_metric_value(r, &rules_agg[i], &value)) continue;
+
+        int32_t x = r->sign * value;
+        uint32_t bit = 1u << i;
+        bool firing = rules_firing & bit;
+        if (!firing && x > r->on) {
+            rules_firing |= bit;
+        } else if (firing && x <= r->off) {
+            rules_firing &= ~bit;
+        } else {
+            continue;
+        }
+
+        rule_event_t ev = {
+            .firing = !firing,
+            .value = value,
+            .threshold = r->sign * r->on,
+            .seq = s->seq,
+            .time = time(NULL),
+        };
+        strcpy(ev.name, r->name);
+        if (xQueueSend(rules_event_queue, &ev, 0) != pdTRUE) {
+            rules_dropped_events++;
+        }
+    }
+    xSemaphoreGive(rules_mutex);
+}
+
+// Отправка одного события на webhook (POST JSON)
+static void rules_post_event(const rule_event_t *ev, const char *url) {
+    char body[192];
+    snprintf(body, sizeof(body),
+             "{\"rule\": \"%s\", \"state\": \"%s\", \"value\": %ld, \"threshold\": %ld, \"seq\": %lu, \"time\": %lld}",
+             ev->name, ev->firing ? "fire" : "clear", (long)ev->value, (long)ev->threshold,
+             (unsigned long)ev->seq, (long long)ev->time);
+    ESP_LOGI(TAG_RULES, "Event: %s", body);
+
+    if (url[0] == '\0') {
+        return; // Webhook не настроен, событие только в логе
+    }
+
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_POST,
+        .timeout_ms = 5000,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (client == NULL) {
+        ESP_LOGE(TAG_RULES, "Failed to create HTTP client");
+        return;
+    }
+    esp_http_client_set_header(client, "Content-Type", "application/json");
+    esp_http_client_set_post_field(client, body, strlen(body));
+    esp_err_t err = esp_http_client_perform(client);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG_RULES, "Webhook POST failed: %s", esp_err_to_name(err));
+    } else if (esp_http_client_get_status_code(client) / 100 != 2) {
+        ESP_LOGW(TAG_RULES, "Webhook responded with HTTP %d", esp_http_client_get_status_code(client));
+    }
+    esp_http_client_cleanup(client);
+}
+
+// Задача отправки событий (PRO_CPU, вместе с остальной сетью)
+static void rules_notify_task(void *arg) {
+    rule_event_t ev;
+    while (1) {
+        if (xQueueReceive(rules_event_queue, &ev, portMAX_DELAY) != pdTRUE) continue;
+
+        char url[RULES_URL_MAX];
+        xSemaphoreTake(rules_mutex, portMAX_DELAY);
+        strcpy(url, rules_webhook_url);
+        xSemaphoreGive(rules_mutex);
+
+        rules_post_event(&ev, url);
+    }
+}
+
+static esp_err_t rules_nvs_get_str(const char *key, char *out, size_t maxlen) {
+    nvs_handle_t h;
+    esp_err_t err = nvs_open("rules", NVS_READONLY, &h);
+    if (err != ESP_OK) return err;
+    size_t len = maxlen;
+    err = nvs_get_str(h, key, out, &len);
+    nvs_close(h);
+    return err;
+}
+
+static esp_err_t rules_nvs_set_str(const char *key, const char *value) {
+    nvs_handle_t h;
+    esp_err_t err = nvs_open("rules", NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    err = nvs_set_str(h, key, value);
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    return err;
+}
+
+// Компиляция и замена активных правил; при save = true текст сохраняется в NVS
+esp_err_t rules_set_text(const char *text, bool save) {
+    rule_t compiled[RULES_MAX];
+    int n = 0;
+    esp_err_t err = rules_compile(text, compiled, &n);
+    if (err != ESP_OK) return err;
+
+    if (save) {
+        err = rules_nvs_set_str("rules", text);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG_RULES, "Failed to save rules: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    xSemaphoreTake(rules_mutex, portMAX_DELAY);
+    memcpy(rules_table, compiled, sizeof(rule_t) * n);
+    rules_count = n;
+    rules_firing = 0;
+    rules_generation++; // Агрегаты окон пересчитаются на следующем отсчёте
+    xSemaphoreGive(rules_mutex);
+
+    ESP_LOGI(TAG_RULES, "%d rule(s) loaded", n);
+    return ESP_OK;
+}
+
+esp_err_t rules_set_webhook(const char *url) {
+    if (strlen(url) >= RULES_URL_MAX) return ESP_ERR_INVALID_SIZE;
+    if (!rules_valid_url(url)) return ESP_ERR_INVALID_ARG;
+    esp_err_t err = rules_nvs_set_str("webhook", url);
+    if (err != ESP_OK) return err;
+    xSemaphoreTake(rules_mutex, portMAX_DELAY);
+    strcpy(rules_webhook_url, url);
+    xSemaphoreGive(rules_mutex);
+    return ESP_OK;
+}
+
+// Снимок правил и их состояния для вывода в /rules (форматируется уже без мьютекса)
+typedef struct {
+    rule_t   rules[RULES_MAX];
+    int      count;
+    uint32_t firing;
+    uint32_t dropped;
+    char     webhook[RULES_URL_MAX];
+} rules_snapshot_t;
+
+void rules_get_snapshot(rules_snapshot_t *out) {
+    xSemaphoreTake(rules_mutex, portMAX_DELAY);
+    memcpy(out->rules, rules_table, sizeof(rule_t) * rules_count);
+    out->count = rules_count;
+    out->firing = rules_firing;
+    out->dropped = rules_dropped_events;
+    strcpy(out->webhook, rules_webhook_url);
+    xSemaphoreGive(rules_mutex);
+}
+
+// Заголовок JSON (до открывающей скобки списка правил)
+int rules_snapshot_header_json(const rules_snapshot_t *snap, char *out, size_t maxlen) {
+    return snprintf(out, maxlen, "{\"webhook\": \"%s\", \"dropped\": %lu, \"rules\": [",
+                    snap->webhook, (unsigned long)snap->dropped);
+}
+
+// Одно правило в JSON; вместе с разделителем укладывается в RULES_JSON_ENTRY_MAX
+#define RULES_JSON_ENTRY_MAX 256
+int rules_snapshot_rule_json(const rules_snapshot_t *snap, int i, char *out, size_t maxlen) {
+    const rule_t *r = &snap->rules[i];
+    return snprintf(out, maxlen,
+                    "%s{\"name\": \"%s\", \"metric\": \"%s\", \"kind\": \"%s\", \"op\": \"%c\", "
+                    "\"threshold\": %ld, \"hyst\": %ld, \"win\": %d, \"firing\": %s}",
+                    i ? ", " : "", r->name, rule_metric_names[r->metric], rule_kind_names[r->kind],
+                    r->sign > 0 ? '>' : '<', (long)(r->sign * r->on), (long)(r->on - r->off),
+                    r->window, (snap->firing & (1u << i)) ? "true" : "false");
+}
+
+// Инициализация: загрузка правил и webhook из NVS, регистрация в acq_scheduler.
+// Вызывать после nvs_flash_init() и до acq_scheduler_start().
+esp_err_t rules_init(void) {
+    rules_mutex = xSemaphoreCreateMutex();
+    rules_event_queue = xQueueCreate(RULES_EVENT_QUEUE_LEN, sizeof(rule_event_t));
+    if (rules_mutex == NULL || rules_event_queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (rules_nvs_get_str("webhook", rules_webhook_url, sizeof(rules_webhook_url)) != ESP_OK ||
+        !rules_valid_url(rules_webhook_url)) {
+        rules_webhook_url[0] = '\0';
+    }
+
+    char text[RULES_TEXT_MAX];
+    esp_err_t err = rules_nvs_get_str("rules", text, sizeof(text));
+    if (err == ESP_OK) {
+        if (rules_set_text(text, false) != ESP_OK) {
+            ESP_LOGE(TAG_RULES, "Stored rules are invalid, starting with none");
+        }
+    } else {
+        ESP_LOGI(TAG_RULES, "No rules in NVS");
+    }
+
+    if (xTaskCreatePinnedToCore(rules_notify_task, "rules_notify", RULES_NOTIFY_STACK_SIZE, NULL,
+                                RULES_NOTIFY_PRIORITY, NULL, NET_TASK_CORE) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    acq_register_sink(rules_sink, NULL);
+    return ESP_OK;
+}
+
+#endif // RULES_ENGINE_H
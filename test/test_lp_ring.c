@@ -0,0 +1,178 @@
+// Проверка логики циклов пробуждения (lp_ring.h) на хосте: make -C test
+#include <stdio.h>
+#include <stdlib.h>
+#include "lp_ring.h"
+
+#define PERIOD_US (60 * 1000000LL)
+#define MIN_SLEEP_US 20000
+#define T0_US (1700000000LL * 1000000)
+
+static int failures = 0;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                      \
+        }                                                                    \
+    } while (0)
+
+// Состояние, которое на устройстве лежит в RTC-памяти
+typedef struct {
+    lp_ring_t ring;
+    int64_t   planned_us;
+    uint32_t  missed;
+    uint32_t  dropped;
+    int       flushes;
+} sim_t;
+
+// Одно пробуждение как в low_power_run(): отсчёт, при необходимости выгрузка, расчёт сна.
+// keep_after_flush - сколько новейших отсчётов остаётся в кольце после выгрузки (0 - всё выгружено).
+// Возвращает время пробуждения следующего цикла.
+static int64_t sim_wake(sim_t *s, int64_t now_us, int64_t awake_us, int64_t flush_us, int keep_after_flush) {
+    s->planned_us = lp_schedule_current(s->planned_us, now_us, PERIOD_US);
+    if (lp_ring_append(&s->ring, s->planned_us / 1000, 100, -100, 2150, 101325)) {
+        s->dropped++;
+    }
+    now_us += awake_us;
+    if (lp_ring_should_flush(&s->ring)) {
+        s->flushes++;
+        now_us += flush_us;
+        lp_ring_keep_newest(&s->ring, keep_after_flush);
+    }
+    s->planned_us = lp_schedule_next(s->planned_us, now_us, PERIOD_US, MIN_SLEEP_US, &s->missed);
+    return s->planned_us;
+}
+
+// Ровные пробуждения: выгрузка на LP_FLUSH_LEVEL-м отсчёте, время в кольце кратно периоду
+static void test_regular_wakes(void) {
+    sim_t *s = calloc(1, sizeof(*s));
+    int64_t now = T0_US;
+    for (int i = 0; i < LP_FLUSH_LEVEL - 1; i++) {
+        now = sim_wake(s, now, 30000, 0, 0);
+    }
+    CHECK(s->flushes == 0);
+    CHECK(s->ring.count == LP_FLUSH_LEVEL - 1);
+    CHECK(s->missed == 0);
+    CHECK(s->ring.base_ms == T0_US / 1000);
+    for (int i = 0; i < s->ring.count; i++) {
+        CHECK(lp_ring_at(&s->ring, i)->t_ofs_ms == (uint32_t)(i * (PERIOD_US / 1000)));
+    }
+    CHECK(lp_ring_at(&s->ring, 0)->press_ofs == 101325 - LP_PRESS_BASE);
+
+    now = sim_wake(s, now, 30000, 4000000, 0);
+    CHECK(s->flushes == 1);
+    CHECK(s->ring.count == 0);
+    CHECK(now == T0_US + (int64_t)LP_FLUSH_LEVEL * PERIOD_US);
+
+    // После выгрузки кольцо начинается с новой базы
+    sim_wake(s, now, 30000, 0, 0);
+    CHECK(s->ring.count == 1);
+    CHECK(s->ring.base_ms == now / 1000);
+    CHECK(lp_ring_at(&s->ring, 0)->t_ofs_ms == 0);
+    free(s);
+}
+
+// Выгрузка дольше периода: пропущенные периоды считаются, сон не короче минимального
+static void test_long_flush_skips_periods(void) {
+    sim_t *s = calloc(1, sizeof(*s));
+    int64_t now = T0_US;
+    for (int i = 0; i < LP_FLUSH_LEVEL - 1; i++) {
+        now = sim_wake(s, now, 30000, 0, 0);
+    }
+    int64_t wake = now;
+    now = sim_wake(s, now, 30000, 2 * PERIOD_US + 10000, 0);
+    CHECK(s->missed == 2);
+    CHECK(now == wake + 3 * PERIOD_US);
+
+    // Расписание сохраняет фазу: следующий отсчёт ровно через период
+    int64_t next = sim_wake(s, now, 30000, 0, 0);
+    CHECK(next == now + PERIOD_US);
+    CHECK(s->missed == 2);
+
+    // Граница минимального сна
+    uint32_t missed = 0;
+    CHECK(lp_schedule_next(T0_US, T0_US + PERIOD_US - MIN_SLEEP_US, PERIOD_US, MIN_SLEEP_US, &missed) ==
+          T0_US + PERIOD_US);
+    CHECK(missed == 0);
+    CHECK(lp_schedule_next(T0_US, T0_US + PERIOD_US - MIN_SLEEP_US + 1, PERIOD_US, MIN_SLEEP_US, &missed) ==
+          T0_US + 2 * PERIOD_US);
+    CHECK(missed == 1);
+    free(s);
+}
+
+// Выгрузки не удаются и флеш недоступен: кольцо не очищается, старейшие вытесняются
+static void test_failed_flushes_keep_ring(void) {
+    sim_t *s = calloc(1, sizeof(*s));
+    int64_t now = T0_US;
+    const int wakes = LP_RING_CAPACITY + 25;
+    for (int i = 0; i < wakes; i++) {
+        now = sim_wake(s, now, 30000, 100000, LP_RING_CAPACITY);
+    }
+    CHECK(s->ring.count == LP_RING_CAPACITY);
+    CHECK(s->dropped == wakes - LP_RING_CAPACITY);
+    CHECK(s->flushes == wakes - LP_FLUSH_LEVEL + 1);
+
+    // В кольце новейшие отсчёты по порядку, время восстанавливается от прежней базы
+    for (int i = 0; i < s->ring.count; i++) {
+        int64_t t_ms = s->ring.base_ms + lp_ring_at(&s->ring, i)->t_ofs_ms;
+        CHECK(t_ms == (T0_US + (int64_t)(wakes - LP_RING_CAPACITY + i) * PERIOD_US) / 1000);
+    }
+    free(s);
+}
+
+// Выгрузка частично удалась: в кольце остаются только новейшие неотправленные отсчёты
+static void test_partial_flush(void) {
+    sim_t *s = calloc(1, sizeof(*s));
+    int64_t now = T0_US;
+    for (int i = 0; i < LP_FLUSH_LEVEL; i++) {
+        now = sim_wake(s, now, 30000, 100000, 10);
+    }
+    CHECK(s->flushes == 1);
+    CHECK(s->ring.count == 10);
+    int64_t t_ms = s->ring.base_ms + lp_ring_at(&s->ring, 0)->t_ofs_ms;
+    CHECK(t_ms == (T0_US + (int64_t)(LP_FLUSH_LEVEL - 10) * PERIOD_US) / 1000);
+
+    // Следующий отсчёт дописывается после них, не сбрасывая базу
+    int64_t base = s->ring.base_ms;
+    sim_wake(s, now, 30000, 0, 0);
+    CHECK(s->ring.count == 11);
+    CHECK(s->ring.base_ms == base);
+    t_ms = s->ring.base_ms + lp_ring_at(&s->ring, 10)->t_ofs_ms;
+    CHECK(t_ms == now / 1000);
+    free(s);
+}
+
+// Первый запуск и переставленные часы начинают расписание заново
+static void test_schedule_restart(void) {
+    CHECK(lp_schedule_current(0, T0_US, PERIOD_US) == T0_US);
+    CHECK(lp_schedule_current(T0_US, T0_US + 50000, PERIOD_US) == T0_US);   // Проснулись чуть позже
+    CHECK(lp_schedule_current(T0_US, T0_US - 50000, PERIOD_US) == T0_US);   // Чуть раньше
+    CHECK(lp_schedule_current(T0_US, T0_US + 3600 * 1000000LL, PERIOD_US) == T0_US + 3600 * 1000000LL);
+    CHECK(lp_schedule_current(T0_US, T0_US - 3600 * 1000000LL, PERIOD_US) == T0_US - 3600 * 1000000LL);
+}
+
+// Давление за пределами 16-битного смещения ограничивается, а не переполняется
+static void test_pressure_clamp(void) {
+    lp_ring_t *r = calloc(1, sizeof(*r));
+    lp_ring_append(r, 0, 0, 0, 0, 0);
+    lp_ring_append(r, 0, 0, 0, 0, LP_PRESS_BASE + 70000);
+    CHECK(lp_ring_at(r, 0)->press_ofs == 0);
+    CHECK(lp_ring_at(r, 1)->press_ofs == UINT16_MAX);
+    free(r);
+}
+
+int main(void) {
+    test_regular_wakes();
+    test_long_flush_skips_periods();
+    test_failed_flushes_keep_ring();
+    test_partial_flush();
+    test_schedule_restart();
+    test_pressure_clamp();
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All lp_ring checks passed\n");
+    return 0;
+}
@@ -0,0 +1,132 @@
+// Проверка формата пакета выгрузки (uplink_codec.h) на хосте: make -C test
+#include <stdio.h>
+#include <string.h>
+#include "uplink_codec.h"
+
+#define MAX_SAMPLES 128
+#define PERIOD_MS 5000
+#define T0_MS 1700000000000LL
+
+static int failures = 0;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                      \
+        }                                                                    \
+    } while (0)
+
+static uint8_t buf[UPLINK_BATCH_MAX_BYTES(MAX_SAMPLES)];
+static uplink_sample_t decoded[MAX_SAMPLES];
+
+static bool same(const uplink_sample_t *a, const uplink_sample_t *b) {
+    return a->seq == b->seq && a->t_ms == b->t_ms && a->a0 == b->a0 && a->a1 == b->a1 &&
+           a->temp == b->temp && a->press == b->press;
+}
+
+// Кодирование, разбор и сверка с исходными отсчётами; возвращает размер пакета
+static size_t round_trip(const uplink_sample_t *s, int n, int64_t period_ms) {
+    size_t len = uplink_encode_batch(s, n, period_ms, buf);
+    CHECK(len <= (size_t)UPLINK_BATCH_MAX_BYTES(n));
+
+    uint32_t first, last, count;
+    CHECK(uplink_batch_range(buf, len, &first, &last, &count));
+    CHECK(first == s[0].seq && last == s[n - 1].seq && count == (uint32_t)n);
+
+    int64_t period = 0;
+    int got = uplink_decode_batch(buf, len, decoded, MAX_SAMPLES, &period);
+    CHECK(got == n);
+    CHECK(period == period_ms);
+    for (int i = 0; i < n && i < got; i++) {
+        if (!same(&decoded[i], &s[i])) {
+            printf("sample %d differs: seq %lu/%lu t %lld/%lld\n", i, (unsigned long)decoded[i].seq,
+                   (unsigned long)s[i].seq, (long long)decoded[i].t_ms, (long long)s[i].t_ms);
+            failures++;
+            break;
+        }
+    }
+    return len;
+}
+
+// Ровный период и плавные значения: около 6 байт на отсчёт
+static void test_regular(void) {
+    uplink_sample_t s[60];
+    for (int i = 0; i < 60; i++) {
+        s[i] = (uplink_sample_t){
+            .seq = 1000 + i, .t_ms = T0_MS + (int64_t)i * PERIOD_MS,
+            .a0 = (int16_t)(12000 + i), .a1 = (int16_t)(8000 - i), .temp = 2150 + i % 3, .press = 101325 - i,
+        };
+    }
+    size_t len = round_trip(s, 60, PERIOD_MS);
+    CHECK(len < 60 * 7 + 38);
+}
+
+// Прореживание: пропуски номеров с шагом 2, 4, 8 и время, кратное пропущенным периодам
+static void test_decimated_gaps(void) {
+    uplink_sample_t s[40];
+    uint32_t seq = 500;
+    for (int i = 0; i < 40; i++) {
+        s[i] = (uplink_sample_t){ .seq = seq, .t_ms = T0_MS + (int64_t)(seq - 500) * PERIOD_MS, .press = 100000 };
+        seq += (i < 10) ? 2 : (i < 25) ? 4 : 8;
+    }
+    round_trip(s, 40, PERIOD_MS);
+}
+
+// Отрицательные дельты, джиттер времени в обе стороны и крайние значения полей
+static void test_negative_and_extreme(void) {
+    uplink_sample_t s[8] = {
+        { .seq = 7, .t_ms = T0_MS,                      .a0 = INT16_MAX, .a1 = INT16_MIN, .temp = INT32_MAX, .press = UINT32_MAX },
+        { .seq = 8, .t_ms = T0_MS + PERIOD_MS - 37,     .a0 = INT16_MIN, .a1 = INT16_MAX, .temp = INT32_MIN, .press = 0 },
+        { .seq = 9, .t_ms = T0_MS + 2 * PERIOD_MS + 41, .a0 = -1,        .a1 = 0,         .temp = -4000,     .press = 30000 },
+        { .seq = 10, .t_ms = T0_MS + 2 * PERIOD_MS,     .a0 = 0,         .a1 = -1,        .temp = -4001,     .press = 29999 },
+        { .seq = 13, .t_ms = T0_MS + 90 * PERIOD_MS,    .a0 = 5,         .a1 = -5,        .temp = 0,         .press = 110000 },
+        { .seq = 14, .t_ms = T0_MS - 3600000,           .a0 = -5,        .a1 = 5,         .temp = 1,         .press = 1 },
+        { .seq = 15, .t_ms = 0,                         .a0 = 0,         .a1 = 0,         .temp = 0,         .press = 0 },
+        { .seq = 16, .t_ms = T0_MS,                     .a0 = 1,         .a1 = 1,         .temp = 1,         .press = 1 },
+    };
+    round_trip(s, 8, PERIOD_MS);
+}
+
+// Пакет из одного отсчёта и переполнение номера через UINT32_MAX
+static void test_single_and_wrap(void) {
+    uplink_sample_t one = { .seq = 42, .t_ms = T0_MS, .a0 = -300, .a1 = 300, .temp = -1250, .press = 99000 };
+    round_trip(&one, 1, PERIOD_MS);
+
+    uplink_sample_t s[4];
+    for (int i = 0; i < 4; i++) {
+        s[i] = (uplink_sample_t){ .seq = UINT32_MAX - 1 + i, .t_ms = T0_MS + (int64_t)i * 60000, .press = 101000 };
+    }
+    round_trip(s, 4, 60000);
+}
+
+// Повреждённые и обрезанные пакеты не разбираются
+static void test_corrupted(void) {
+    uplink_sample_t s[3] = {
+        { .seq = 1, .t_ms = T0_MS, .a0 = 1 },
+        { .seq = 2, .t_ms = T0_MS + PERIOD_MS, .a0 = 2 },
+        { .seq = 3, .t_ms = T0_MS + 2 * PERIOD_MS, .a0 = 3 },
+    };
+    size_t len = uplink_encode_batch(s, 3, PERIOD_MS, buf);
+    int64_t period;
+    CHECK(uplink_decode_batch(buf, len - 1, decoded, MAX_SAMPLES, &period) == -1);
+    CHECK(uplink_decode_batch(buf, len, decoded, 2, &period) == -1);
+    buf[2] = UPLINK_FORMAT_VERSION + 1;
+    CHECK(uplink_decode_batch(buf, len, decoded, MAX_SAMPLES, &period) == -1);
+    uint32_t first, last, count;
+    CHECK(!uplink_batch_range(buf, len, &first, &last, &count));
+}
+
+int main(void) {
+    test_regular();
+    test_decimated_gaps();
+    test_negative_and_extreme();
+    test_single_and_wrap();
+    test_corrupted();
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All uplink codec checks passed\n");
+    return 0;
+}
@@ -0,0 +1,649 @@
+#ifndef UPLINK_H
+#define UPLINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include "esp_log.h"
+#include "esp_idf_version.h"
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+#include "mqtt_client.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "acq_scheduler.h"
+#include "wifi_connect.h" // s_wifi_event_group / WIFI_CONNECTED_BIT
+#include "uplink_codec.h"
+
+// === Пакетная выгрузка данных (store-and-forward) ===
+// Каждый отсчёт попадает в кольцевой буфер в RAM. Задача выгрузки (PRO_CPU) собирает
+// из него пакеты по UPLINK_BATCH_SIZE отсчётов, сжимает и отправляет одним запросом
+// на HTTP-коллектор (POST) или MQTT-брокер (QoS 1). Отсчёт удаляется из очереди только
+// после подтверждения (HTTP 2xx / PUBACK). Пока сети нет, старейшие пакеты уходят
+// из RAM во флеш (NVS), а при дальнейшем росте очереди включается прореживание.
+//
+// Настройки в NVS, пространство "uplink":
+//   url   - http://host:port/path или mqtt://host:port (например, локальный mosquitto)
+//   topic - MQTT-топик, по умолчанию "garden/samples"
+//   acked - следующий неподтверждённый номер (с него выгрузка продолжается после сбоя)
+//
+// Формат пакета и его разбор - в uplink_codec.h.
+//
+// Поддерживаются http://, https://, mqtt:// и mqtts://. Сертификаты сервера для TLS
+// проверяются по встроенному набору корневых сертификатов (esp_crt_bundle).
+
+#define UPLINK_RAM_CAPACITY 240    // Отсчётов в RAM (20 мин при периоде 5 с)
+#define UPLINK_BATCH_SIZE 60       // Отсчётов в пакете (5 мин)
+#define UPLINK_BATCH_MAX 120       // Наибольший пакет: под него буферы (кольцо режима пониженного потребления)
+#define UPLINK_SPILL_LEVEL (UPLINK_RAM_CAPACITY - UPLINK_BATCH_SIZE) // С этого уровня пакет уходит во флеш
+#define UPLINK_FLASH_SLOTS 12      // Пакетов во флеше
+#define UPLINK_MAX_LATENCY_MS (5 * 60 * 1000LL) // Неполный пакет отправляется не позже этого
+#define UPLINK_SEQ_RESERVE 1024    // Номера резервируются в NVS блоками, а не на каждый отсчёт
+#define UPLINK_ACK_TIMEOUT_MS 10000
+#define UPLINK_RETRY_MIN_MS 2000
+#define UPLINK_RETRY_MAX_MS 60000
+#define UPLINK_URL_MAX 128
+#define UPLINK_TOPIC_MAX 64
+#define UPLINK_TASK_STACK_SIZE 6144
+#define UPLINK_TASK_PRIORITY (tskIDLE_PRIORITY + 3)
+#define UPLINK_BATCH_BUF_SIZE UPLINK_BATCH_MAX_BYTES(UPLINK_BATCH_MAX)
+
+#define UPLINK_MQTT_CONNECTED_BIT BIT0
+#define UPLINK_MQTT_PUBLISHED_BIT BIT1
+
+static const char *TAG_UPLINK = "UPLINK";
+
+typedef struct {
+    uint32_t acked_seq;      // Следующий неподтверждённый номер
+    uint32_t batches_sent;
+    uint32_t samples_sent;
+    uint32_t bytes_sent;
+    uint32_t send_errors;
+    uint32_t dropped;        // Потеряны при переполнении RAM/флеша
+    uint32_t downsampled;    // Отброшены прореживанием
+    uint32_t spilled;        // Пакетов записано во флеш
+} uplink_stats_t;
+
+// Очередь в RAM (защищена uplink_lock)
+static uplink_sample_t uplink_ram[UPLINK_RAM_CAPACITY];
+static int uplink_ram_head = 0;  // Индекс следующей записи
+static int uplink_ram_count = 0;
+static portMUX_TYPE uplink_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t uplink_next_seq = 0;
+static uint32_t uplink_seq_reserved = 0; // Номера до этого значения уже зарезервированы в NVS
+static int64_t uplink_period_ms = ACQ_PERIOD_US / 1000; // Период отсчётов, пишется в заголовок пакета
+static int uplink_batch_size = UPLINK_BATCH_SIZE;       // Отсчётов в пакете, не больше UPLINK_BATCH_MAX
+static uplink_stats_t uplink_stats;
+
+// Очередь во флеше: слоты NVS "b<n>", n = счётчик % UPLINK_FLASH_SLOTS
+static uint32_t uplink_flash_head = 0;
+static uint32_t uplink_flash_tail = 0;
+
+static char uplink_url[UPLINK_URL_MAX] = "";
+static char uplink_topic[UPLINK_TOPIC_MAX] = "garden/samples";
+static char uplink_pending_url[UPLINK_URL_MAX];   // Новые настройки до применения задачей выгрузки
+static char uplink_pending_topic[UPLINK_TOPIC_MAX];
+static bool uplink_reconfigure = false;
+static TaskHandle_t uplink_task_handle = NULL;
+
+// Транспорт; используется только задачей выгрузки
+static esp_http_client_handle_t uplink_http = NULL;
+static esp_mqtt_client_handle_t uplink_mqtt = NULL;
+static EventGroupHandle_t uplink_mqtt_events = NULL;
+// PUBACK сверяется с msg_id в обработчике событий (задача MQTT), под uplink_mqtt_lock
+#define UPLINK_MQTT_NONE -1      // Ничего не ждём
+#define UPLINK_MQTT_PUBLISHING 0 // Идёт публикация, msg_id ещё неизвестен (id MQTT не бывает 0)
+#define UPLINK_MQTT_EARLY_ACKS 4
+static portMUX_TYPE uplink_mqtt_lock = portMUX_INITIALIZER_UNLOCKED;
+static int uplink_mqtt_wait_id = UPLINK_MQTT_NONE;
+static int uplink_mqtt_early_acks[UPLINK_MQTT_EARLY_ACKS]; // PUBACK, пришедшие во время публикации
+static int uplink_mqtt_early_count = 0;
+
+// Буферы задачи выгрузки (статически, чтобы не раздувать стек)
+static uplink_sample_t uplink_batch[UPLINK_BATCH_MAX];
+static uint8_t uplink_batch_buf[UPLINK_BATCH_BUF_SIZE];
+
+// === NVS ===
+static esp_err_t uplink_nvs_set_u32(const char *key, uint32_t value) {
+    nvs_handle_t h;
+    esp_err_t err = nvs_open("uplink", NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    err = nvs_set_u32(h, key, value);
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    return err;
+}
+
+static void uplink_slot_key(uint32_t counter, char *key, size_t maxlen) {
+    snprintf(key, maxlen, "b%lu", (unsigned long)(counter % UPLINK_FLASH_SLOTS));
+}
+
+static esp_err_t uplink_flash_write(const uint8_t *data, size_t len) {
+    char key[8];
+    uplink_slot_key(uplink_flash_head, key, sizeof(key));
+    nvs_handle_t h;
+    esp_err_t err = nvs_open("uplink", NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    err = nvs_set_blob(h, key, data, len);
+    if (err == ESP_OK) err = nvs_set_u32(h, "fl_head", uplink_flash_head + 1);
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    if (err == ESP_OK) uplink_flash_head++;
+    return err;
+}
+
+static esp_err_t uplink_flash_read_tail(uint8_t *out, size_t *len) {
+    char key[8];
+    uplink_slot_key(uplink_flash_tail, key, sizeof(key));
+    nvs_handle_t h;
+    esp_err_t err = nvs_open("uplink", NVS_READONLY, &h);
+    if (err != ESP_OK) return err;
+    err = nvs_get_blob(h, key, out, len);
+    nvs_close(h);
+    return err;
+}
+
+static void uplink_flash_pop_tail(void) {
+    char key[8];
+    uplink_slot_key(uplink_flash_tail, key, sizeof(key));
+    nvs_handle_t h;
+    if (nvs_open("uplink", NVS_READWRITE, &h) == ESP_OK) {
+        nvs_erase_key(h, key);
+        nvs_set_u32(h, "fl_tail", uplink_flash_tail + 1);
+        nvs_commit(h);
+        nvs_close(h);
+    }
+    uplink_flash_tail++;
+}
+
+// === Очередь в RAM ===
+// Коэффициент прореживания по заполненности всей очереди (RAM + флеш)
+static int uplink_decimation(void) {
+    const int capacity = UPLINK_RAM_CAPACITY + UPLINK_FLASH_SLOTS * uplink_batch_size;
+    int backlog = uplink_ram_count + (int)(uplink_flash_head - uplink_flash_tail) * uplink_batch_size;
+    if (backlog < capacity / 2) return 1;
+    if (backlog < capacity * 3 / 4) return 2;
+    if (backlog < capacity * 9 / 10) return 4;
+    return 8;
+}
+
+// Копия старейших отсчётов (до max штук)
+static int uplink_ram_peek(uplink_sample_t *out, int max) {
+    portENTER_CRITICAL(&uplink_lock);
+    int n = uplink_ram_count < max ? uplink_ram_count : max;
+    int idx = (uplink_ram_head - uplink_ram_count + UPLINK_RAM_CAPACITY) % UPLINK_RAM_CAPACITY;
+    for (int i = 0; i < n; i++) {
+        out[i] = uplink_ram[idx];
+        idx = (idx + 1) % UPLINK_RAM_CAPACITY;
+    }
+    portEXIT_CRITICAL(&uplink_lock);
+    return n;
+}
+
+// Удаление отсчётов до last_seq включительно. По номеру, а не по количеству:
+// пока пакет отправлялся, получатель мог вытеснить старейшие отсчёты.
+static void uplink_ram_pop_through(uint32_t last_seq) {
+    portENTER_CRITICAL(&uplink_lock);
+    while (uplink_ram_count > 0) {
+        int idx = (uplink_ram_head - uplink_ram_count + UPLINK_RAM_CAPACITY) % UPLINK_RAM_CAPACITY;
+        if ((int32_t)(uplink_ram[idx].seq - last_seq) > 0) break;
+        uplink_ram_count--;
+    }
+    portEXIT_CRITICAL(&uplink_lock);
+}
+
+// Постановка отсчёта в очередь; номер (seq) присваивается здесь
+static void uplink_push(const uplink_sample_t *sample) {
+    portENTER_CRITICAL(&uplink_lock);
+    uint32_t seq = uplink_next_seq++;
+    int factor = uplink_decimation();
+    if (seq % factor != 0) {
+        uplink_stats.downsampled++;
+        portEXIT_CRITICAL(&uplink_lock);
+        return;
+    }
+    if (uplink_ram_count == UPLINK_RAM_CAPACITY) {
+        uplink_ram_count--; // Вытесняем старейший отсчёт
+        uplink_stats.dropped++;
+    }
+    uplink_ram[uplink_ram_head] = *sample;
+    uplink_ram[uplink_ram_head].seq = seq;
+    uplink_ram_head = (uplink_ram_head + 1) % UPLINK_RAM_CAPACITY;
+    uplink_ram_count++;
+    bool wake = uplink_ram_count >= uplink_batch_size || seq + UPLINK_SEQ_RESERVE / 2 >= uplink_seq_reserved;
+    portEXIT_CRITICAL(&uplink_lock);
+
+    if (wake && uplink_task_handle != NULL) {
+        xTaskNotifyGive(uplink_task_handle);
+    }
+}
+
+// Получатель отсчётов для acq_scheduler
+static void uplink_sink(const acq_sample_t *s, void *ctx) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    // Плановое время отсчёта в UNIX-времени: период в пакете остаётся точным
+    int64_t t_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000 - (esp_timer_get_time() - s->t_sched_us) / 1000;
+
+    uplink_sample_t sample = {
+        .t_ms = t_ms,
+        .a0 = s->a0,
+        .a1 = s->a1,
+        .temp = s->temp,
+        .press = s->press,
+    };
+    uplink_push(&sample);
+}
+
+// Продление резерва номеров в NVS, чтобы после перезагрузки номера не повторялись
+static void uplink_reserve_seq_if_needed(void) {
+    portENTER_CRITICAL(&uplink_lock);
+    uint32_t next = uplink_next_seq;
+    portEXIT_CRITICAL(&uplink_lock);
+    if (next + UPLINK_SEQ_RESERVE / 2 < uplink_seq_reserved) return;
+    if (uplink_nvs_set_u32("seq_rsv", next + UPLINK_SEQ_RESERVE) == ESP_OK) {
+        uplink_seq_reserved = next + UPLINK_SEQ_RESERVE;
+    }
+}
+
+// Точный следующий номер в NVS вместо резерва блоком. Для deep sleep: каждое пробуждение -
+// новая загрузка, и резерв блоками оставлял бы пропуск почти в UPLINK_SEQ_RESERVE номеров.
+static void uplink_save_seq(void) {
+    portENTER_CRITICAL(&uplink_lock);
+    uint32_t next = uplink_next_seq;
+    portEXIT_CRITICAL(&uplink_lock);
+    if (uplink_nvs_set_u32("seq_rsv", next) == ESP_OK) {
+        uplink_seq_reserved = next;
+    }
+}
+
+// Отсчётов в очереди RAM (не подтверждены и не перенесены во флеш)
+static int uplink_ram_queued(void) {
+    portENTER_CRITICAL(&uplink_lock);
+    int count = uplink_ram_count;
+    portEXIT_CRITICAL(&uplink_lock);
+    return count;
+}
+
+// Перенос старейших пакетов из RAM во флеш, пока в RAM не меньше level отсчётов
+static void uplink_spill_if_needed(int level) {
+    while (1) {
+        portENTER_CRITICAL(&uplink_lock);
+        int count = uplink_ram_count;
+        portEXIT_CRITICAL(&uplink_lock);
+        if (count < level || count == 0) return;
+
+        if (uplink_flash_head - uplink_flash_tail >= UPLINK_FLASH_SLOTS) {
+            // Флеш заполнен: теряем старейший пакет, а не свежие данные
+            size_t len = sizeof(uplink_batch_buf);
+            uint32_t first, last, n = 0;
+            if (uplink_flash_read_tail(uplink_batch_buf, &len) == ESP_OK) {
+                uplink_batch_range(uplink_batch_buf, len, &first, &last, &n);
+            }
+            uplink_flash_pop_tail();
+            portENTER_CRITICAL(&uplink_lock);
+            uplink_stats.dropped += n;
+            portEXIT_CRITICAL(&uplink_lock);
+        }
+
+        int n = uplink_ram_peek(uplink_batch, uplink_batch_size);
+        size_t len = uplink_encode_batch(uplink_batch, n, uplink_period_ms, uplink_batch_buf);
+        esp_err_t err = uplink_flash_write(uplink_batch_buf, len);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG_UPLINK, "Failed to spill batch to flash: %s", esp_err_to_name(err));
+            return; // Очередь в RAM продолжит работать с вытеснением
+        }
+        uplink_ram_pop_through(uplink_batch[n - 1].seq);
+        portENTER_CRITICAL(&uplink_lock);
+        uplink_stats.spilled++;
+        portEXIT_CRITICAL(&uplink_lock);
+        ESP_LOGI(TAG_UPLINK, "Spilled %d samples (%u bytes) to flash", n, (unsigned)len);
+    }
+}
+
+// === Транспорт ===
+static void uplink_mqtt_event_handler(void *arg, esp_event_base_t base, int32_t event_id, void *event_data) {
+    esp_mqtt_event_handle_t event = event_data;
+    switch ((esp_mqtt_event_id_t)event_id) {
+        case MQTT_EVENT_CONNECTED:
+            xEventGroupSetBits(uplink_mqtt_events, UPLINK_MQTT_CONNECTED_BIT);
+            break;
+        case MQTT_EVENT_DISCONNECTED:
+            xEventGroupClearBits(uplink_mqtt_events, UPLINK_MQTT_CONNECTED_BIT);
+            break;
+        case MQTT_EVENT_PUBLISHED: {
+            // Бит ставится только для ожидаемого пакета: запоздавший PUBACK прошлой попытки
+            // не должен ни выставить его, ни затереть подтверждение текущей
+            bool match = false;
+            portENTER_CRITICAL(&uplink_mqtt_lock);
+            if (event->msg_id == uplink_mqtt_wait_id) {
+                match = true;
+            } else if (uplink_mqtt_wait_id == UPLINK_MQTT_PUBLISHING) {
+                uplink_mqtt_early_acks[uplink_mqtt_early_count++ % UPLINK_MQTT_EARLY_ACKS] = event->msg_id;
+            }
+            portEXIT_CRITICAL(&uplink_mqtt_lock);
+            if (match) {
+                xEventGroupSetBits(uplink_mqtt_events, UPLINK_MQTT_PUBLISHED_BIT);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static esp_err_t uplink_mqtt_send(const uint8_t *data, size_t len) {
+    if (uplink_mqtt_events == NULL) {
+        uplink_mqtt_events = xEventGroupCreate();
+        if (uplink_mqtt_events == NULL) return ESP_ERR_NO_MEM;
+    }
+    if (uplink_mqtt == NULL) {
+        esp_mqtt_client_config_t config = {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+            .broker.address.uri = uplink_url,
+#else
+            .uri = uplink_url,
+#endif
+            // Для mqtts://; для mqtt:// не используется
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+            .broker.verification.crt_bundle_attach = esp_crt_bundle_attach,
+#else
+            .crt_bundle_attach = esp_crt_bundle_attach,
+#endif
+        };
+        uplink_mqtt = esp_mqtt_client_init(&config);
+        if (uplink_mqtt == NULL) return ESP_FAIL;
+        esp_mqtt_client_register_event(uplink_mqtt, ESP_EVENT_ANY_ID, uplink_mqtt_event_handler, NULL);
+        esp_mqtt_client_start(uplink_mqtt); // Дальше клиент переподключается сам
+    }
+
+    if (!(xEventGroupWaitBits(uplink_mqtt_events, UPLINK_MQTT_CONNECTED_BIT, pdFALSE, pdFALSE,
+                              pdMS_TO_TICKS(UPLINK_ACK_TIMEOUT_MS)) & UPLINK_MQTT_CONNECTED_BIT)) {
+        ESP_LOGW(TAG_UPLINK, "MQTT broker not connected");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    // msg_id известен только после публикации, поэтому пока она идёт, обработчик запоминает
+    // все PUBACK: подтверждение могло прийти раньше, чем мы начали его ждать
+    portENTER_CRITICAL(&uplink_mqtt_lock);
+    uplink_mqtt_wait_id = UPLINK_MQTT_PUBLISHING;
+    uplink_mqtt_early_count = 0;
+    portEXIT_CRITICAL(&uplink_mqtt_lock);
+    xEventGroupClearBits(uplink_mqtt_events, UPLINK_MQTT_PUBLISHED_BIT);
+
+    int msg_id = esp_mqtt_client_publish(uplink_mqtt, uplink_topic, (const char *)data, (int)len, 1, 0);
+    bool acked = false;
+    portENTER_CRITICAL(&uplink_mqtt_lock);
+    uplink_mqtt_wait_id = msg_id < 0 ? UPLINK_MQTT_NONE : msg_id;
+    int early = uplink_mqtt_early_count < UPLINK_MQTT_EARLY_ACKS ? uplink_mqtt_early_count : UPLINK_MQTT_EARLY_ACKS;
+    for (int i = 0; i < early && msg_id >= 0; i++) {
+        if (uplink_mqtt_early_acks[i] == msg_id) acked = true;
+    }
+    portEXIT_CRITICAL(&uplink_mqtt_lock);
+    if (msg_id < 0) return ESP_FAIL;
+
+    if (!acked) {
+        acked = xEventGroupWaitBits(uplink_mqtt_events, UPLINK_MQTT_PUBLISHED_BIT, pdTRUE, pdFALSE,
+                                    pdMS_TO_TICKS(UPLINK_ACK_TIMEOUT_MS)) & UPLINK_MQTT_PUBLISHED_BIT;
+    }
+    portENTER_CRITICAL(&uplink_mqtt_lock);
+    uplink_mqtt_wait_id = UPLINK_MQTT_NONE;
+    portEXIT_CRITICAL(&uplink_mqtt_lock);
+    if (!acked) {
+        ESP_LOGW(TAG_UPLINK, "No PUBACK for msg_id %d", msg_id);
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t uplink_http_send(const uint8_t *data, size_t len, uint32_t first, uint32_t last) {
+    if (uplink_http == NULL) {
+        // Клиент сохраняется между пакетами: соединение (и TLS-сессия для https://) переиспользуется
+        esp_http_client_config_t config = {
+            .url = uplink_url,
+            .method = HTTP_METHOD_POST,
+            .timeout_ms = UPLINK_ACK_TIMEOUT_MS,
+            .crt_bundle_attach = esp_crt_bundle_attach,
+        };
+        uplink_http = esp_http_client_init(&config);
+        if (uplink_http == NULL) return ESP_FAIL;
+    }
+
+    char range[24];
+    snprintf(range, sizeof(range), "%lu-%lu", (unsigned long)first, (unsigned long)last);
+    esp_http_client_set_header(uplink_http, "Content-Type", "application/octet-stream");
+    esp_http_client_set_header(uplink_http, "X-Batch-Seq", range);
+    esp_http_client_set_post_field(uplink_http, (const char *)data, (int)len);
+
+    esp_err_t err = esp_http_client_perform(uplink_http);
+    int status = esp_http_client_get_status_code(uplink_http);
+    if (err != ESP_OK || status / 100 != 2) {
+        ESP_LOGW(TAG_UPLINK, "HTTP upload failed: %s, status %d", esp_err_to_name(err), status);
+        esp_http_client_cleanup(uplink_http);
+        uplink_http = NULL;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static void uplink_transport_reset(void) {
+    if (uplink_http != NULL) {
+        esp_http_client_cleanup(uplink_http);
+        uplink_http = NULL;
+    }
+    if (uplink_mqtt != NULL) {
+        esp_mqtt_client_stop(uplink_mqtt);
+        esp_mqtt_client_destroy(uplink_mqtt);
+        uplink_mqtt = NULL;
+        xEventGroupClearBits(uplink_mqtt_events, UPLINK_MQTT_CONNECTED_BIT | UPLINK_MQTT_PUBLISHED_BIT);
+    }
+}
+
+static esp_err_t uplink_transport_send(const uint8_t *data, size_t len, uint32_t first, uint32_t last) {
+    esp_err_t err = (strncmp(uplink_url, "mqtt", 4) == 0) ? uplink_mqtt_send(data, len)
+                                                            : uplink_http_send(data, len, first, last);
+    portENTER_CRITICAL(&uplink_lock);
+    if (err == ESP_OK) {
+        uplink_stats.batches_sent++;
+        uplink_stats.bytes_sent += len;
+    } else {
+        uplink_stats.send_errors++;
+    }
+    portEXIT_CRITICAL(&uplink_lock);
+    return err;
+}
+
+static void uplink_ack(uint32_t last_seq, uint32_t count) {
+    portENTER_CRITICAL(&uplink_lock);
+    uplink_stats.acked_seq = last_seq + 1;
+    uplink_stats.samples_sent += count;
+    portEXIT_CRITICAL(&uplink_lock);
+    uplink_nvs_set_u32("acked", last_seq + 1);
+}
+
+// Отправка следующего пакета: сначала флеш (там всегда более старые данные), затем RAM.
+// flush = true - неполный пакет из RAM отправляется сразу, не дожидаясь UPLINK_MAX_LATENCY_MS.
+// ESP_ERR_NOT_FOUND - отправлять пока нечего.
+static esp_err_t uplink_send_next(bool flush) {
+    if (uplink_flash_head != uplink_flash_tail) {
+        size_t len = sizeof(uplink_batch_buf);
+        uint32_t first, last, count;
+        if (uplink_flash_read_tail(uplink_batch_buf, &len) != ESP_OK ||
+            !uplink_batch_range(uplink_batch_buf, len, &first, &last, &count)) {
+            ESP_LOGE(TAG_UPLINK, "Corrupted flash batch, skipping");
+            uplink_flash_pop_tail();
+            return ESP_OK;
+        }
+        if ((int32_t)(last - uplink_stats.acked_seq) < 0) {
+            uplink_flash_pop_tail(); // Подтверждён до перезагрузки, но не успел удалиться
+            return ESP_OK;
+        }
+        esp_err_t err = uplink_transport_send(uplink_batch_buf, len, first, last);
+        if (err == ESP_OK) {
+            uplink_ack(last, count);
+            uplink_flash_pop_tail();
+        }
+        return err;
+    }
+
+    int n = uplink_ram_peek(uplink_batch, uplink_batch_size);
+    if (n == 0) return ESP_ERR_NOT_FOUND;
+    if (n < uplink_batch_size && !flush) {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        int64_t now_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+        if (now_ms - uplink_batch[0].t_ms < UPLINK_MAX_LATENCY_MS) return ESP_ERR_NOT_FOUND;
+    }
+
+    size_t len = uplink_encode_batch(uplink_batch, n, uplink_period_ms, uplink_batch_buf);
+    uint32_t first = uplink_batch[0].seq, last = uplink_batch[n - 1].seq;
+    esp_err_t err = uplink_transport_send(uplink_batch_buf, len, first, last);
+    if (err == ESP_OK) {
+        uplink_ack(last, n);
+        uplink_ram_pop_through(last);
+    }
+    return err;
+}
+
+static void uplink_task(void *arg) {
+    int retry_ms = UPLINK_RETRY_MIN_MS;
+    int64_t next_attempt_us = 0;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+        uplink_reserve_seq_if_needed();
+        uplink_spill_if_needed(UPLINK_SPILL_LEVEL); // Работает и без сети
+
+        portENTER_CRITICAL(&uplink_lock);
+        bool reconfigure = uplink_reconfigure;
+        if (reconfigure) {
+            strcpy(uplink_url, uplink_pending_url);
+            strcpy(uplink_topic, uplink_pending_topic);
+            uplink_reconfigure = false;
+        }
+        portEXIT_CRITICAL(&uplink_lock);
+        if (reconfigure) {
+            uplink_transport_reset();
+            next_attempt_us = 0;
+        }
+        if (uplink_url[0] == '\0' || !(xEventGroupGetBits(s_wifi_event_group) & WIFI_CONNECTED_BIT) ||
+            esp_timer_get_time() < next_attempt_us) {
+            continue;
+        }
+
+        // После восстановления Wi-Fi выгружаем весь накопленный хвост подряд
+        while (1) {
+            esp_err_t err = uplink_send_next(false);
+            if (err == ESP_ERR_NOT_FOUND) {
+                retry_ms = UPLINK_RETRY_MIN_MS;
+                break;
+            }
+            if (err != ESP_OK) {
+                next_attempt_us = esp_timer_get_time() + (int64_t)retry_ms * 1000;
+                retry_ms = retry_ms * 2 > UPLINK_RETRY_MAX_MS ? UPLINK_RETRY_MAX_MS : retry_ms * 2;
+                break;
+            }
+            retry_ms = UPLINK_RETRY_MIN_MS;
+            uplink_reserve_seq_if_needed();
+            uplink_spill_if_needed(UPLINK_SPILL_LEVEL);
+        }
+    }
+}
+
+// Новые адрес и топик; сохраняются в NVS и применяются перед следующей отправкой
+esp_err_t uplink_set_config(const char *url, const char *topic) {
+    if (strlen(url) >= UPLINK_URL_MAX || (topic && strlen(topic) >= UPLINK_TOPIC_MAX)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    nvs_handle_t h;
+    esp_err_t err = nvs_open("uplink", NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    err = nvs_set_str(h, "url", url);
+    if (err == ESP_OK && topic) err = nvs_set_str(h, "topic", topic);
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    if (err != ESP_OK) return err;
+
+    // Задача выгрузки применит настройки между отправками и пересоздаст транспорт
+    portENTER_CRITICAL(&uplink_lock);
+    strcpy(uplink_pending_url, url);
+    strcpy(uplink_pending_topic, topic ? topic : uplink_topic);
+    uplink_reconfigure = true;
+    portEXIT_CRITICAL(&uplink_lock);
+    if (uplink_task_handle != NULL) {
+        xTaskNotifyGive(uplink_task_handle);
+    }
+    return ESP_OK;
+}
+
+// Состояние очереди в JSON (для /uplink)
+// Худший случай для uplink_stats_to_json: текст ~330 байт, 11 чисел по 10 цифр, URL и топик
+#define UPLINK_JSON_MAX (448 + UPLINK_URL_MAX + UPLINK_TOPIC_MAX)
+int uplink_stats_to_json(char *out, size_t maxlen) {
+    portENTER_CRITICAL(&uplink_lock);
+    uplink_stats_t s = uplink_stats;
+    int queued = uplink_ram_count;
+    int decimation = uplink_decimation();
+    uint32_t next_seq = uplink_next_seq;
+    char url[UPLINK_URL_MAX], topic[UPLINK_TOPIC_MAX];
+    strcpy(url, uplink_url);
+    strcpy(topic, uplink_topic);
+    portEXIT_CRITICAL(&uplink_lock);
+
+    uint32_t raw = s.samples_sent * (uint32_t)sizeof(uplink_sample_t);
+    return snprintf(out, maxlen,
+                    "{\"url\": \"%s\", \"topic\": \"%s\", \"next_seq\": %lu, \"acked_seq\": %lu, "
+                    "\"queued_ram\": %d, \"queued_flash_batches\": %lu, \"decimation\": %d, "
+                    "\"batches_sent\": %lu, \"samples_sent\": %lu, \"bytes_sent\": %lu, \"raw_bytes\": %lu, "
+                    "\"send_errors\": %lu, \"dropped\": %lu, \"downsampled\": %lu, \"spilled\": %lu}",
+                    url, topic, (unsigned long)next_seq, (unsigned long)s.acked_seq,
+                    queued, (unsigned long)(uplink_flash_head - uplink_flash_tail), decimation,
+                    (unsigned long)s.batches_sent, (unsigned long)s.samples_sent, (unsigned long)s.bytes_sent,
+                    (unsigned long)raw, (unsigned long)s.send_errors, (unsigned long)s.dropped,
+                    (unsigned long)s.downsampled, (unsigned long)s.spilled);
+}
+
+// Загрузка настроек и состояния очереди из NVS (без запуска задачи выгрузки)
+static void uplink_load_state(void) {
+    nvs_handle_t h;
+    if (nvs_open("uplink", NVS_READONLY, &h) == ESP_OK) {
+        size_t len = sizeof(uplink_url);
+        if (nvs_get_str(h, "url", uplink_url, &len) != ESP_OK) uplink_url[0] = '\0';
+        len = sizeof(uplink_topic);
+        if (nvs_get_str(h, "topic", uplink_topic, &len) != ESP_OK) strcpy(uplink_topic, "garden/samples");
+        nvs_get_u32(h, "acked", &uplink_stats.acked_seq);
+        nvs_get_u32(h, "seq_rsv", &uplink_seq_reserved);
+        nvs_get_u32(h, "fl_head", &uplink_flash_head);
+        nvs_get_u32(h, "fl_tail", &uplink_flash_tail);
+        nvs_close(h);
+    }
+    // Продолжаем нумерацию с конца прошлого резерва: номера не повторяются
+    uplink_next_seq = uplink_seq_reserved > uplink_stats.acked_seq ? uplink_seq_reserved : uplink_stats.acked_seq;
+
+    ESP_LOGI(TAG_UPLINK, "Resuming at seq %lu, acked %lu, %lu batch(es) in flash",
+             (unsigned long)uplink_next_seq, (unsigned long)uplink_stats.acked_seq,
+             (unsigned long)(uplink_flash_head - uplink_flash_tail));
+    if (uplink_url[0] == '\0') {
+        ESP_LOGW(TAG_UPLINK, "No uplink URL configured, samples are queued only");
+    }
+}
+
+// Инициализация: состояние очереди из NVS, задача выгрузки на PRO_CPU, регистрация в acq_scheduler.
+// Вызывать после nvs_flash_init() и wifi_init_sta(), до acq_scheduler_start().
+esp_err_t uplink_init(void) {
+    uplink_load_state();
+    uplink_reserve_seq_if_needed();
+
+    if (xTaskCreatePinnedToCore(uplink_task, "uplink", UPLINK_TASK_STACK_SIZE, NULL,
+                                UPLINK_TASK_PRIORITY, &uplink_task_handle, NET_TASK_CORE) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    acq_register_sink(uplink_sink, NULL);
+    return ESP_OK;
+}
+
+#endif // UPLINK_H
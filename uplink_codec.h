@@ -0,0 +1,138 @@
+#ifndef UPLINK_CODEC_H
+#define UPLINK_CODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// === Формат пакета выгрузки ===
+// Кодирование и разбор пакета без зависимостей от ESP-IDF: uplink.h кодирует, а
+// uplink_decode_batch() - эталонный разбор для коллектора и проверки на хосте
+// (test/test_uplink_codec.c).
+//
+// Все числа - varint LEB128, знаковые - zigzag:
+//   'G' 'B' <версия> <кол-во> <первый seq> <последний seq - первый> <период, мс> <t0, мс UNIX>
+//   затем на каждый отсчёт: <dseq> <dt - dseq * период> <da0> <da1> <dtemp> <dpress>
+// Дельты считаются от предыдущего отсчёта (для первого - от нулей, seq и t - от заголовка),
+// поэтому при ровном периоде отсчёт занимает около 6 байт вместо ~80 байт JSON в /sensors.
+// Пропуски номеров (прореживание) передаются через dseq и не ломают временную шкалу.
+
+#define UPLINK_FORMAT_VERSION 1
+// Худший случай varint: заголовок 3 + 5 + 5 + 5 + 10 + 10, отсчёт 5 + 10 + 3 + 3 + 5 + 5
+#define UPLINK_BATCH_MAX_BYTES(n) (38 + (n) * 31)
+
+typedef struct {
+    uint32_t seq;
+    int64_t  t_ms;   // UNIX-время отсчёта, мс
+    int16_t  a0;
+    int16_t  a1;
+    int32_t  temp;   // °C * 100
+    uint32_t press;  // Па
+} uplink_sample_t;
+
+static size_t uplink_put_varint(uint8_t *p, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static size_t uplink_get_varint(const uint8_t *p, size_t len, uint64_t *v) {
+    *v = 0;
+    for (size_t n = 0; n < len && n < 10; n++) {
+        *v |= (uint64_t)(p[n] & 0x7F) << (7 * n);
+        if ((p[n] & 0x80) == 0) return n + 1;
+    }
+    return 0;
+}
+
+static uint64_t uplink_zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t uplink_unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// Кодирование n >= 1 отсчётов; out - не меньше UPLINK_BATCH_MAX_BYTES(n) байт
+static size_t uplink_encode_batch(const uplink_sample_t *s, int n, int64_t period_ms, uint8_t *out) {
+    size_t len = 0;
+    out[len++] = 'G';
+    out[len++] = 'B';
+    out[len++] = UPLINK_FORMAT_VERSION;
+    len += uplink_put_varint(out + len, (uint64_t)n);
+    len += uplink_put_varint(out + len, s[0].seq);
+    len += uplink_put_varint(out + len, s[n - 1].seq - s[0].seq);
+    len += uplink_put_varint(out + len, (uint64_t)period_ms);
+    len += uplink_put_varint(out + len, (uint64_t)s[0].t_ms);
+
+    uplink_sample_t prev = { .seq = s[0].seq, .t_ms = s[0].t_ms };
+    for (int i = 0; i < n; i++) {
+        uint32_t dseq = s[i].seq - prev.seq;
+        len += uplink_put_varint(out + len, dseq);
+        len += uplink_put_varint(out + len, uplink_zigzag(s[i].t_ms - prev.t_ms - (int64_t)dseq * period_ms));
+        len += uplink_put_varint(out + len, uplink_zigzag((int64_t)s[i].a0 - prev.a0));
+        len += uplink_put_varint(out + len, uplink_zigzag((int64_t)s[i].a1 - prev.a1));
+        len += uplink_put_varint(out + len, uplink_zigzag((int64_t)s[i].temp - prev.temp));
+        len += uplink_put_varint(out + len, uplink_zigzag((int64_t)s[i].press - prev.press));
+        prev = s[i];
+    }
+    return len;
+}
+
+// Номера первого и последнего отсчёта из заголовка пакета
+static bool uplink_batch_range(const uint8_t *buf, size_t len, uint32_t *first, uint32_t *last, uint32_t *count) {
+    if (len < 3 || buf[0] != 'G' || buf[1] != 'B' || buf[2] != UPLINK_FORMAT_VERSION) return false;
+    size_t pos = 3;
+    uint64_t v[3];
+    for (int i = 0; i < 3; i++) {
+        size_t n = uplink_get_varint(buf + pos, len - pos, &v[i]);
+        if (n == 0) return false;
+        pos += n;
+    }
+    *count = (uint32_t)v[0];
+    *first = (uint32_t)v[1];
+    *last = (uint32_t)(v[1] + v[2]);
+    return true;
+}
+
+// Разбор пакета в out (не больше max отсчётов). Возвращает число отсчётов или -1,
+// если пакет повреждён, не помещается в out или не сходится с заголовком.
+static int uplink_decode_batch(const uint8_t *buf, size_t len, uplink_sample_t *out, int max, int64_t *period_ms) {
+    if (len < 3 || buf[0] != 'G' || buf[1] != 'B' || buf[2] != UPLINK_FORMAT_VERSION) return -1;
+    size_t pos = 3;
+    uint64_t h[5]; // кол-во, первый seq, размах seq, период, t0
+    for (int i = 0; i < 5; i++) {
+        size_t k = uplink_get_varint(buf + pos, len - pos, &h[i]);
+        if (k == 0) return -1;
+        pos += k;
+    }
+    if (h[0] == 0 || h[0] > (uint64_t)max) return -1;
+    int n = (int)h[0];
+    *period_ms = (int64_t)h[3];
+
+    uplink_sample_t prev = { .seq = (uint32_t)h[1], .t_ms = (int64_t)h[4] };
+    for (int i = 0; i < n; i++) {
+        uint64_t f[6];
+        for (int j = 0; j < 6; j++) {
+            size_t k = uplink_get_varint(buf + pos, len - pos, &f[j]);
+            if (k == 0) return -1;
+            pos += k;
+        }
+        uplink_sample_t *s = &out[i];
+        s->seq = prev.seq + (uint32_t)f[0];
+        s->t_ms = prev.t_ms + (int64_t)(uint32_t)f[0] * *period_ms + uplink_unzigzag(f[1]);
+        s->a0 = (int16_t)(prev.a0 + uplink_unzigzag(f[2]));
+        s->a1 = (int16_t)(prev.a1 + uplink_unzigzag(f[3]));
+        s->temp = (int32_t)(prev.temp + uplink_unzigzag(f[4]));
+        s->press = (uint32_t)(prev.press + uplink_unzigzag(f[5]));
+        prev = *s;
+    }
+    if (pos != len || out[n - 1].seq != (uint32_t)(h[1] + h[2])) return -1;
+    return n;
+}
+
+#endif // UPLINK_CODEC_H
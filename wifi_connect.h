@@ -1,7 +1,9 @@
 #ifndef WIFI_CONNECT_H
 #define WIFI_CONNECT_H
 
+#include <string.h>
 #include "esp_log.h"
+#include "esp_attr.h" // RTC_DATA_ATTR
 #include "esp_event.h"
 #include "nvs_flash.h"
 #include "esp_netif.h"
@@ -21,11 +23,20 @@ static EventGroupHandle_t s_wifi_event_group;
 /* The event group bit for indicating connection */
 #define WIFI_CONNECTED_BIT BIT0
 
+/* Параметры последнего успешного подключения. Хранятся в RTC-памяти и переживают
+ * deep sleep, чтобы при следующем подключении не сканировать все каналы. */
+RTC_DATA_ATTR static uint8_t wifi_cached_bssid[6];
+RTC_DATA_ATTR static uint8_t wifi_cached_channel = 0; // 0 - кэша нет
+
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                                 int32_t event_id, void* event_data)
 {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
         esp_wifi_connect();
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        wifi_event_sta_connected_t* event = (wifi_event_sta_connected_t*) event_data;
+        memcpy(wifi_cached_bssid, event->bssid, sizeof(wifi_cached_bssid));
+        wifi_cached_channel = event->channel;
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
         ESP_LOGI(WIFI_TAG, "Disconnected from WiFi, retrying...");
         esp_wifi_connect(); // Повторная попытка подключения
@@ -37,7 +48,8 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
     }
 }
 
-static inline void wifi_init_sta(void) {
+// Общая часть инициализации STA; use_cache - подключаться к BSSID/каналу из RTC-памяти
+static void wifi_start_sta(bool use_cache) {
     s_wifi_event_group = xEventGroupCreate();
 
     ESP_ERROR_CHECK(esp_netif_init());
@@ -68,11 +80,20 @@ static inline void wifi_init_sta(void) {
             .pmf_cfg = {.capable = true, .required = false}, // PMF (Protected Management Frames)
         },
     };
+    if (use_cache && wifi_cached_channel != 0) {
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, wifi_cached_bssid, sizeof(wifi_cached_bssid));
+        wifi_config.sta.channel = wifi_cached_channel; // Сканируется только этот канал
+    }
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
     ESP_ERROR_CHECK(esp_wifi_start());
 
     ESP_LOGI(WIFI_TAG, "Connecting to WiFi...");
+}
+
+static inline void wifi_init_sta(void) {
+    wifi_start_sta(false);
 
     /* Waiting until either the connection is established (WIFI_CONNECTED_BIT) or connection failed.
      * The event group is created in app_main() or before. */
@@ -94,4 +115,23 @@ static inline void wifi_init_sta(void) {
     // vEventGroupDelete(s_wifi_event_group);
 }
 
+// Быстрое подключение с параметрами из RTC-памяти (режим пониженного потребления).
+// Если за timeout_ms подключиться не удалось, кэш сбрасывается: точка доступа могла
+// сменить канал, и в следующий раз будет полное сканирование.
+static inline bool wifi_connect_cached(uint32_t timeout_ms) {
+    wifi_start_sta(true);
+
+    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group,
+                                           WIFI_CONNECTED_BIT,
+                                           pdFALSE,
+                                           pdFALSE,
+                                           pdMS_TO_TICKS(timeout_ms));
+    if (!(bits & WIFI_CONNECTED_BIT)) {
+        ESP_LOGE(WIFI_TAG, "Failed to connect to WiFi within %lu ms", (unsigned long)timeout_ms);
+        wifi_cached_channel = 0;
+        return false;
+    }
+    return true;
+}
+
 #endif // WIFI_CONNECT_H
\ No newline at end of file